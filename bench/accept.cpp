@@ -0,0 +1,96 @@
+// connection storm: clients connect, exchange one byte and reset, as fast as they can
+// compares accepting one connection per wakeup with batched accept, and SO_REUSEPORT with a shared EPOLLEXCLUSIVE socket
+// usage: bench_accept [threads] [clients] [seconds]
+#include <wheel/server.hpp>
+#include <wheel/stream_handler.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using wheel::ServerMode;
+using wheel::ServerOptions;
+
+namespace {
+
+class EchoHandler : public wheel::StreamHandler {
+public:
+    bool on_recv(std::span<const char> data, std::string& reply) override {
+        reply.append(data.data(), data.size());
+        return true;
+    }
+};
+
+// connections per second
+double bench(ServerOptions options, unsigned short port, int threads, int clients, double seconds) {
+    wheel::Server<EchoHandler> server(options);
+    std::thread server_thread([&] { server.start(port, threads); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::atomic<bool> stop = false;
+    std::atomic<long long> connections = 0;
+    std::vector<std::thread> workers;
+    for (int i = 0; i < clients; ++i) {
+        workers.emplace_back([&] {
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(port);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            linger reset{.l_onoff = 1, .l_linger = 0};  // no TIME_WAIT, the ephemeral ports would run out
+            long long count = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                int fd = socket(AF_INET, SOCK_STREAM, 0);
+                setsockopt(fd, SOL_SOCKET, SO_LINGER, &reset, sizeof reset);
+                char c = 'x';
+                if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) == 0
+                        && send(fd, &c, 1, MSG_NOSIGNAL) == 1 && recv(fd, &c, 1, 0) == 1) {
+                    ++count;
+                }
+                close(fd);
+            }
+            connections += count;
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    server.stop();
+    server_thread.join();
+    return connections / seconds;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int threads = argc > 1 ? std::atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+    int clients = argc > 2 ? std::atoi(argv[2]) : 16;
+    double seconds = argc > 3 ? std::atof(argv[3]) : 2;
+
+    struct Config {
+        const char* name;
+        ServerOptions options;
+    };
+    Config configs[] = {
+        {"thread pool, 1", {.mode = ServerMode::THREAD_POOL, .accept_batch = 1}},
+        {"thread pool, 64", {.mode = ServerMode::THREAD_POOL, .accept_batch = 64}},
+        {"reuseport, 1", {.mode = ServerMode::MULTI_REACTOR, .accept_batch = 1}},
+        {"reuseport, 64", {.mode = ServerMode::MULTI_REACTOR, .accept_batch = 64}},
+        {"exclusive, 64", {.mode = ServerMode::MULTI_REACTOR, .accept_batch = 64, .reuse_port = false}},
+    };
+    std::printf("threads: %d, clients: %d\n", threads, clients);
+    std::printf("%-20s %12s\n", "server, batch", "conn/s");
+    unsigned short port = 19200;
+    for (auto& config : configs) {
+        std::printf("%-20s %12.0f\n", config.name, bench(config.options, port++, threads, clients, seconds));
+    }
+    return 0;
+}
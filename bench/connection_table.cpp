@@ -0,0 +1,64 @@
+// connection churn: accept(insert a new handler) + close(erase) with many connections open
+// std::unordered_map<int, std::unique_ptr> + make_unique against the recycling ConnectionTable
+// usage: bench_connection_table [open connections] [operations]
+#include <wheel/connection_table.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// about the size of a StreamHandler
+class Handler : public wheel::SocketHandler {
+public:
+    bool process() override { return true; }
+
+private:
+    char buf_[4096];
+};
+
+template <typename Insert, typename Erase>
+double ns_per_op(int open, int ops, Insert insert, Erase erase) {
+    std::mt19937 rng(42);
+    std::vector<int> fds(open);
+    for (int i = 0; i < open; ++i) {
+        fds[i] = i + 16;
+        insert(fds[i]);
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ops; ++i) {
+        // a random connection closes and its fd is reused by the next accept, as the kernel does
+        int fd = fds[rng() % open];
+        erase(fd);
+        insert(fd);
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ops;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int open = argc > 1 ? std::atoi(argv[1]) : 10000;
+    int ops = argc > 2 ? std::atoi(argv[2]) : 1000000;
+
+    std::unordered_map<int, std::unique_ptr<wheel::SocketHandler>> map;
+    double map_ns = ns_per_op(open, ops,
+        [&](int fd) { map[fd] = std::make_unique<Handler>(); },
+        [&](int fd) { map.erase(fd); });
+
+    wheel::ConnectionTable table(sizeof(Handler), alignof(Handler), 1024);
+    double table_ns = ns_per_op(open, ops,
+        [&](int fd) { table.emplace<Handler>(fd); },
+        [&](int fd) { table.erase(fd); });
+
+    std::printf("open connections: %d\n", open);
+    std::printf("%-18s %8s\n", "", "ns/churn");
+    std::printf("%-18s %8.1f\n", "unordered_map", map_ns);
+    std::printf("%-18s %8.1f\n", "ConnectionTable", table_ns);
+    return 0;
+}
@@ -0,0 +1,104 @@
+// echo round trips per second: THREAD_POOL(one epoll loop + pool), MULTI_REACTOR(SO_REUSEPORT, inline)
+// and IO_URING(multishot accept / recv, one io_uring_enter per batch)
+// usage: bench_echo [threads] [connections] [seconds]
+#include <wheel/server.hpp>
+#include <wheel/stream_handler.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using wheel::ServerMode;
+
+namespace {
+
+class EchoHandler : public wheel::StreamHandler {
+public:
+    bool on_recv(std::span<const char> data, std::string& reply) override {
+        reply.append(data.data(), data.size());
+        return true;
+    }
+};
+
+int connect_to(unsigned short port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (int i = 0; i < 100; ++i) {
+        if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) == 0) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+            return fd;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));  // server still starting
+    }
+    return -1;
+}
+
+void bench(const char* name, ServerMode mode, unsigned short port, int threads, int connections, double seconds) {
+    wheel::Server<EchoHandler> server({.mode = mode});
+    std::thread server_thread([&] { server.start(port, threads); });
+
+    std::atomic<bool> stop = false;
+    std::atomic<long long> round_trips = 0;
+    std::vector<std::thread> clients;
+    for (int i = 0; i < connections; ++i) {
+        clients.emplace_back([&] {
+            int fd = connect_to(port);
+            if (fd < 0) {
+                return;
+            }
+            char buf[64] = {};
+            long long count = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (send(fd, buf, sizeof buf, MSG_NOSIGNAL) != sizeof buf) {
+                    break;
+                }
+                size_t received = 0;
+                while (received < sizeof buf) {
+                    int n = recv(fd, buf + received, sizeof buf - received, 0);
+                    if (n <= 0) {
+                        break;
+                    }
+                    received += n;
+                }
+                ++count;
+            }
+            round_trips += count;
+            close(fd);
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    for (auto& client : clients) {
+        client.join();
+    }
+    server.stop();
+    server_thread.join();
+    std::printf("%-16s %12.0f\n", name, round_trips / seconds);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int threads = argc > 1 ? std::atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+    int connections = argc > 2 ? std::atoi(argv[2]) : 32;
+    double seconds = argc > 3 ? std::atof(argv[3]) : 3;
+
+    std::printf("threads: %d, connections: %d, 64 byte messages\n", threads, connections);
+    std::printf("%-16s %12s\n", "server", "round trip/s");
+    bench("thread pool", ServerMode::THREAD_POOL, 19001, threads, connections, seconds);
+    bench("multi reactor", ServerMode::MULTI_REACTOR, 19002, threads, connections, seconds);
+    bench("io_uring", ServerMode::IO_URING, 19003, threads, connections, seconds);
+    return 0;
+}
@@ -0,0 +1,71 @@
+// wake up latency and cpu burn under bursty load: park at once vs spin then park, fixed vs elastic size
+// usage: bench_elastic [threads] [bursts]
+#include <wheel/thread_pool.hpp>
+
+#include <sys/resource.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+using wheel::ElasticPolicy;
+using wheel::Priority;
+using wheel::ThreadPool;
+
+namespace {
+
+double cpu_seconds() {
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    auto seconds = [](timeval t) { return t.tv_sec + t.tv_usec / 1e6; };
+    return seconds(usage.ru_utime) + seconds(usage.ru_stime);
+}
+
+// BURST tiny tasks every GAP, the pool is idle in between
+void bench(const char* name, int threads, int bursts, const ElasticPolicy& policy) {
+    constexpr int BURST = 64;
+    constexpr auto GAP = std::chrono::milliseconds(2);
+
+    ThreadPool pool(policy.max_threads ? policy.min_threads : threads);
+    pool.set_elastic(policy);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    std::atomic<int> done = 0;
+    double cpu = cpu_seconds();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < bursts; ++i) {
+        for (int j = 0; j < BURST; ++j) {
+            pool.post([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+        }
+        std::this_thread::sleep_for(GAP);
+    }
+    while (done.load(std::memory_order_relaxed) != bursts * BURST) {
+        std::this_thread::yield();
+    }
+    double wall = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    cpu = cpu_seconds() - cpu;
+
+    auto wait = pool.stats(Priority::NORMAL).queue_wait;
+    std::printf("%-24s %10.1f %10.1f %10.1f %12.2f %8d\n", name, wait.percentile(0.5) / 1e3,
+                wait.percentile(0.99) / 1e3, wait.percentile(1) / 1e3, cpu / wall, pool.size());
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int threads = argc > 1 ? std::atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+    int bursts = argc > 2 ? std::atoi(argv[2]) : 500;
+    using std::chrono::microseconds;
+    using std::chrono::milliseconds;
+
+    std::printf("threads: %d, bursts: %d, queue wait in us, cpu is cpu seconds per wall second\n", threads, bursts);
+    std::printf("%-24s %10s %10s %10s %12s %8s\n", "pool", "p50", "p99", "max", "cpu", "threads");
+    bench("fixed, park", threads, bursts, {});
+    bench("fixed, spin 20us", threads, bursts, {.spin = microseconds(20)});
+    bench("fixed, spin 200us", threads, bursts, {.spin = microseconds(200)});
+    bench("elastic, park", threads, bursts, {.min_threads = 1, .max_threads = threads, .idle_timeout = milliseconds(1)});
+    bench("elastic, spin 20us", threads, bursts,
+          {.min_threads = 1, .max_threads = threads, .idle_timeout = milliseconds(1), .spin = microseconds(20)});
+    return 0;
+}
@@ -0,0 +1,128 @@
+// heap allocations and throughput per task: submit(std::future) vs async(wheel::Future) vs post
+// usage: bench_job [threads] [tasks]
+#include <wheel/thread_pool.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+std::atomic<long long> allocations = 0;
+
+}  // namespace
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+using wheel::ThreadPoolMode;
+
+struct Result {
+    double tasks_per_second;
+    double allocations_per_task;
+};
+
+// run twice, the first round warms up the free lists
+template <typename F>
+Result measure(int tasks, F&& round) {
+    round();
+    long long before = allocations.load();
+    auto start = std::chrono::steady_clock::now();
+    round();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return {tasks / seconds, static_cast<double>(allocations.load() - before) / tasks};
+}
+
+void wait_for(const std::atomic<int>& count, int expected) {
+    while (count.load(std::memory_order_acquire) != expected) {
+        std::this_thread::yield();
+    }
+}
+
+// at most BATCH tasks in flight, like a request handler fanning out
+constexpr int BATCH = 256;
+
+template <typename Pool>
+void bench(const char* name, ThreadPoolMode mode, int threads, int tasks) {
+    Pool pool(threads, mode);
+    std::vector<std::future<int>> std_futures;
+    std::vector<wheel::Future<int>> futures;
+    std_futures.reserve(BATCH);
+    futures.reserve(BATCH);
+
+    auto submit = measure(tasks, [&] {
+        for (int i = 0; i < tasks; i += BATCH) {
+            std_futures.clear();
+            for (int j = 0; j < BATCH; ++j) {
+                std_futures.push_back(pool.submit([j] { return j; }));
+            }
+            for (auto& future : std_futures) {
+                future.get();
+            }
+        }
+    });
+    auto async = measure(tasks, [&] {
+        for (int i = 0; i < tasks; i += BATCH) {
+            futures.clear();
+            for (int j = 0; j < BATCH; ++j) {
+                futures.push_back(pool.async([j] { return j; }));
+            }
+            for (auto& future : futures) {
+                future.get();
+            }
+        }
+    });
+    auto post = measure(tasks, [&] {
+        std::atomic<int> count = 0;
+        for (int i = 0; i < tasks; ++i) {
+            pool.post([&count] { count.fetch_add(1, std::memory_order_release); });
+        }
+        wait_for(count, tasks);
+    });
+    // posted from inside a worker, goes to its deque in work stealing mode
+    auto nested = measure(tasks, [&] {
+        std::atomic<int> count = 0;
+        for (int i = 0; i < tasks; i += BATCH) {
+            pool.post([&] {
+                for (int j = 0; j < BATCH - 1; ++j) {
+                    pool.post([&count] { count.fetch_add(1, std::memory_order_release); });
+                }
+                count.fetch_add(1, std::memory_order_release);
+            });
+        }
+        wait_for(count, tasks);
+    });
+
+    std::printf("%-10s %10.0f %6.2f %10.0f %6.2f %10.0f %6.2f %10.0f %6.2f\n", name,
+                submit.tasks_per_second, submit.allocations_per_task,
+                async.tasks_per_second, async.allocations_per_task,
+                post.tasks_per_second, post.allocations_per_task,
+                nested.tasks_per_second, nested.allocations_per_task);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int threads = argc > 1 ? std::atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+    int tasks = argc > 2 ? std::atoi(argv[2]) : 1 << 18;
+    tasks = tasks / BATCH * BATCH;
+
+    std::printf("threads: %d, tasks: %d, columns are task/s and allocations/task\n", threads, tasks);
+    std::printf("%-10s %17s %17s %17s %17s\n", "pool", "submit", "async", "post", "nested post");
+    bench<wheel::ThreadPool>("global", ThreadPoolMode::GLOBAL_QUEUE, threads, tasks);
+    bench<wheel::LockFreeThreadPool>("lockfree", ThreadPoolMode::GLOBAL_QUEUE, threads, tasks);
+    bench<wheel::ThreadPool>("stealing", ThreadPoolMode::WORK_STEALING, threads, tasks);
+    return 0;
+}
@@ -0,0 +1,97 @@
+// small message throughput through MessageHandler: one client pipelines messages, the server counts them
+// and answers the last one
+// usage: bench_message [messages] [message size]
+#include <wheel/message_handler.hpp>
+#include <wheel/server.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+using wheel::Framing;
+using wheel::MessageHandler;
+
+namespace {
+
+template <Framing F>
+class CountHandler : public MessageHandler {
+public:
+    CountHandler() : MessageHandler(F) {}
+
+    using MessageHandler::process;
+
+    bool process(std::string_view msg) override {
+        if (msg == "end") {
+            send(std::to_string(count_));
+            count_ = 0;
+        } else {
+            ++count_;
+        }
+        return true;
+    }
+
+private:
+    long long count_ = 0;
+};
+
+// messages per second
+template <Framing F>
+double bench(unsigned short port, int messages, int size) {
+    wheel::Server<CountHandler<F>> server({.mode = wheel::ServerMode::MULTI_REACTOR});
+    std::thread server_thread([&] { server.start(port, 1); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::string batch;
+    std::string msg(size, 'm');
+    char header[MessageHandler::MAX_HEADER];
+    for (int i = 0; i < 1024; ++i) {
+        batch.append(header, MessageHandler::encode_header(F, msg.size(), header));
+        batch += msg;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int sent = 0; sent < messages; sent += 1024) {
+        for (size_t off = 0; off < batch.size();) {
+            off += std::max<ssize_t>(0, send(fd, batch.data() + off, batch.size() - off, MSG_NOSIGNAL));
+        }
+    }
+    std::string end;
+    end.append(header, MessageHandler::encode_header(F, 3, header));
+    end += "end";
+    send(fd, end.data(), end.size(), MSG_NOSIGNAL);
+    char reply[64];
+    recv(fd, reply, sizeof reply, 0);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    close(fd);
+    server.stop();
+    server_thread.join();
+    return (messages + 1023) / 1024 * 1024 / seconds;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int messages = argc > 1 ? std::atoi(argv[1]) : 4000000;
+    int size = argc > 2 ? std::atoi(argv[2]) : 32;
+
+    std::printf("messages: %d, size: %d\n", messages, size);
+    std::printf("%-10s %12s\n", "framing", "msg/s");
+    std::printf("%-10s %12.0f\n", "decimal", bench<Framing::DECIMAL>(19401, messages, size));
+    std::printf("%-10s %12.0f\n", "u32", bench<Framing::U32>(19402, messages, size));
+    std::printf("%-10s %12.0f\n", "varint", bench<Framing::VARINT>(19403, messages, size));
+    return 0;
+}
@@ -0,0 +1,72 @@
+// SafeQueue vs MPMCQueue, P producers and P consumers
+// usage: bench_mpmc_queue [items]
+#include <wheel/mpmc_queue.hpp>
+#include <wheel/safe_queue.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+namespace {
+
+template <typename Queue>
+double bench(Queue& queue, int threads, int items) {
+    int per_thread = items / threads;
+    int total = per_thread * threads;
+    std::atomic<int> popped = 0;
+    std::atomic<bool> go = false;
+
+    std::vector<std::thread> producers, consumers;
+    for (int t = 0; t < threads; ++t) {
+        producers.emplace_back([&] {
+            while (!go.load(std::memory_order_acquire)) {}
+            for (int i = 0; i < per_thread; ++i) {
+                int value = i;
+                while (!queue.try_push(std::move(value))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        consumers.emplace_back([&] {
+            while (!go.load(std::memory_order_acquire)) {}
+            int value;
+            while (popped.load(std::memory_order_relaxed) < total) {
+                if (queue.try_pop(value)) {
+                    popped.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& thread : producers) {
+        thread.join();
+    }
+    for (auto& thread : consumers) {
+        thread.join();
+    }
+    return total / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int items = argc > 1 ? std::atoi(argv[1]) : 1 << 22;
+
+    std::printf("items: %d\n", items);
+    std::printf("%-8s %16s %16s\n", "threads", "SafeQueue(op/s)", "MPMCQueue(op/s)");
+    for (int threads : {1, 4, 16, 64}) {
+        wheel::SafeQueue<int> safe_queue;
+        wheel::MPMCQueue<int> mpmc_queue(1 << 16);
+        double a = bench(safe_queue, threads, items);
+        double b = bench(mpmc_queue, threads, items);
+        std::printf("%-8d %16.0f %16.0f\n", threads, a, b);
+    }
+    return 0;
+}
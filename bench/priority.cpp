@@ -0,0 +1,72 @@
+// queue wait of short requests while the pool is saturated by long background tasks
+// usage: bench_priority [threads] [requests]
+#include <wheel/thread_pool.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+using wheel::Priority;
+using wheel::ThreadPool;
+
+namespace {
+
+void spin_for(std::chrono::microseconds duration) {
+    auto end = std::chrono::steady_clock::now() + duration;
+    while (std::chrono::steady_clock::now() < end) {
+    }
+}
+
+// requests arrive every 20us, BACKLOG background tasks of 500us are kept queued per thread
+void bench(const char* name, int threads, int requests, Priority request_priority, Priority load_priority) {
+    constexpr int BACKLOG = 4;
+    ThreadPool pool(threads);
+    std::atomic<bool> stop = false;
+    std::atomic<int> queued = 0;
+
+    std::thread load([&] {
+        while (!stop.load(std::memory_order_relaxed)) {
+            if (queued.load(std::memory_order_relaxed) < BACKLOG * threads) {
+                queued.fetch_add(1, std::memory_order_relaxed);
+                pool.post({.priority = load_priority}, [&queued] {
+                    spin_for(std::chrono::microseconds(500));
+                    queued.fetch_sub(1, std::memory_order_relaxed);
+                });
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));  // saturate first
+
+    std::atomic<int> done = 0;
+    for (int i = 0; i < requests; ++i) {
+        pool.post({.priority = request_priority}, [&done] { done.fetch_add(1, std::memory_order_relaxed); });
+        spin_for(std::chrono::microseconds(20));
+    }
+    while (done.load(std::memory_order_relaxed) != requests) {
+        std::this_thread::yield();
+    }
+    stop = true;
+    load.join();
+
+    auto stats = pool.stats(request_priority);
+    auto& wait = stats.queue_wait;
+    std::printf("%-22s %10.1f %10.1f %10.1f %10.1f\n", name, wait.percentile(0.5) / 1e3, wait.percentile(0.9) / 1e3,
+                wait.percentile(0.99) / 1e3, wait.percentile(1) / 1e3);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int threads = argc > 1 ? std::atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+    int requests = argc > 2 ? std::atoi(argv[2]) : 20000;
+
+    std::printf("threads: %d, requests: %d, queue wait of requests in us\n", threads, requests);
+    std::printf("%-22s %10s %10s %10s %10s\n", "requests / load", "p50", "p90", "p99", "max");
+    bench("normal / normal", threads, requests, Priority::NORMAL, Priority::NORMAL);
+    bench("latency / normal", threads, requests, Priority::LATENCY, Priority::NORMAL);
+    bench("latency / background", threads, requests, Priority::LATENCY, Priority::BACKGROUND);
+    return 0;
+}
@@ -0,0 +1,84 @@
+// request/response latency of a request written in two parts(header, then body): with Nagle the body waits
+// until the header is acked, and the server delays that ack as it has nothing to send before the body arrived
+// either the client turns Nagle off(TCP_NODELAY) or the server acks at once(accepted_socket.quickack)
+// usage: bench_socket_options [round trips]
+#include <wheel/histogram.hpp>
+#include <wheel/server.hpp>
+#include <wheel/socket.hpp>
+#include <wheel/stream_handler.hpp>
+
+#include <sys/socket.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+using wheel::ServerMode;
+
+namespace {
+
+constexpr size_t HEADER = 16, BODY = 48;
+
+// answers a whole request with one byte
+class RequestHandler : public wheel::StreamHandler {
+public:
+    bool on_recv(std::span<const char> data, std::string& reply) override {
+        received_ += data.size();
+        for (; received_ >= HEADER + BODY; received_ -= HEADER + BODY) {
+            reply += '!';
+        }
+        return true;
+    }
+
+private:
+    size_t received_ = 0;
+};
+
+void bench(const char* name, wheel::ServerOptions options, bool client_nodelay, unsigned short port, int round_trips) {
+    options.mode = ServerMode::MULTI_REACTOR;
+    wheel::Server<RequestHandler> server(options);
+    std::thread server_thread([&] { server.start(port, 1); });
+
+    wheel::Socket socket;
+    bool connected = false;
+    for (int i = 0; i < 100 && !connected; ++i) {
+        connected = socket.init(SOCK_STREAM) && socket.connect("127.0.0.1", port);
+        if (!connected) {
+            socket.close();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));  // server still starting
+        }
+    }
+    socket.set_nodelay(client_nodelay);
+    std::string header(HEADER, 'h'), body(BODY, 'b');
+    wheel::Histogram histogram;
+    auto begin = std::chrono::steady_clock::now();
+    for (int i = 0; connected && i < round_trips; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        char c;
+        if (socket.send(header) != HEADER || socket.send(body) != BODY || ::recv(socket.fd(), &c, 1, 0) != 1) {
+            break;
+        }
+        histogram.record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    socket.close();
+    server.stop();
+    server_thread.join();
+    std::printf("%-28s %12.0f %10.1f %10.1f %10.1f\n", name, histogram.count() / seconds, histogram.mean() / 1000,
+                histogram.percentile(0.5) / 1000.0, histogram.percentile(0.99) / 1000.0);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int round_trips = argc > 1 ? std::atoi(argv[1]) : 200;
+
+    std::printf("round trips: %d, %zu + %zu byte requests, latency in us\n", round_trips, HEADER, BODY);
+    std::printf("%-28s %12s %10s %10s %10s\n", "", "round trip/s", "mean", "p50", "p99");
+    bench("defaults", {}, false, 19021, round_trips);
+    bench("server accepted quickack", {.accepted_socket = {.quickack = true}}, false, 19022, round_trips);
+    bench("client nodelay", {}, true, 19023, round_trips);
+    return 0;
+}
@@ -0,0 +1,48 @@
+// per task cost of the ThreadPool counters and sampled timing
+// build with -DWHEEL_THREAD_POOL_STATS=0 for the baseline without any instrumentation
+// usage: bench_stats [tasks]
+#include <wheel/thread_pool.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+using wheel::ThreadPool;
+
+namespace {
+
+// one worker runs tasks it pushed to its own deque, so queue contention does not hide the cost
+double ns_per_task(uint32_t period, int tasks) {
+    ThreadPool pool(1, ThreadPool::Mode::WORK_STEALING);
+    pool.set_stats_sample_period(period);
+    std::atomic<int> done = 0;
+    double best = 1e9;
+    for (int round = 0; round < 5; ++round) {
+        done = 0;
+        auto start = std::chrono::steady_clock::now();
+        pool.post([&] {
+            for (int i = 0; i < tasks; ++i) {
+                pool.post([&done] { done.fetch_add(1, std::memory_order_relaxed); });
+            }
+        });
+        while (done.load(std::memory_order_relaxed) != tasks) {
+            std::this_thread::yield();
+        }
+        best = std::min(best, std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / tasks);
+    }
+    return best;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int tasks = argc > 1 ? std::atoi(argv[1]) : 1 << 20;
+
+    std::printf("WHEEL_THREAD_POOL_STATS=%d, tasks: %d, best of 5 rounds\n", WHEEL_THREAD_POOL_STATS, tasks);
+    std::printf("%-24s %10s\n", "sampling", "ns/task");
+    std::printf("%-24s %10.2f\n", "counters only", ns_per_task(0, tasks));
+    std::printf("%-24s %10.2f\n", "1 in 64 timed", ns_per_task(64, tasks));
+    std::printf("%-24s %10.2f\n", "1 in 16 timed(default)", ns_per_task(16, tasks));
+    std::printf("%-24s %10.2f\n", "every task timed", ns_per_task(1, tasks));
+    return 0;
+}
@@ -0,0 +1,80 @@
+// global queue(SafeQueue / MPMCQueue) vs work stealing
+// usage: bench_thread_pool [threads] [tasks]
+#include <wheel/thread_pool.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+
+using wheel::LockFreeThreadPool;
+using wheel::ThreadPool;
+using wheel::ThreadPoolMode;
+
+namespace {
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void wait_for(const std::atomic<int>& count, int expected) {
+    while (count.load(std::memory_order_acquire) != expected) {
+        std::this_thread::yield();
+    }
+}
+
+// main thread submits every task
+template <typename Pool>
+double bench_external(ThreadPoolMode mode, int threads, int tasks) {
+    Pool pool(threads, mode);
+    std::atomic<int> count = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < tasks; ++i) {
+        pool.submit([&count] { count.fetch_add(1, std::memory_order_release); });
+    }
+    wait_for(count, tasks);
+    return tasks / seconds_since(start);
+}
+
+// tasks submit their own children, binary tree of depth log2(tasks)
+template <typename Pool>
+double bench_fork(ThreadPoolMode mode, int threads, int tasks) {
+    int depth = 0;
+    while ((2 << depth) - 1 < tasks) {
+        ++depth;
+    }
+    int total = (2 << depth) - 1;
+
+    Pool pool(threads, mode);
+    std::atomic<int> count = 0;
+    std::function<void(int)> spawn = [&](int d) {
+        if (d > 0) {
+            pool.submit(spawn, d - 1);
+            pool.submit(spawn, d - 1);
+        }
+        count.fetch_add(1, std::memory_order_release);
+    };
+    auto start = std::chrono::steady_clock::now();
+    pool.submit(spawn, depth);
+    wait_for(count, total);
+    return total / seconds_since(start);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int threads = argc > 1 ? std::atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+    int tasks = argc > 2 ? std::atoi(argv[2]) : 1 << 20;
+
+    std::printf("threads: %d, tasks: %d\n", threads, tasks);
+    std::printf("%-10s %16s %16s %16s\n", "workload", "global(task/s)", "lockfree(task/s)", "stealing(task/s)");
+    std::printf("%-10s %16.0f %16.0f %16.0f\n", "external",
+                bench_external<ThreadPool>(ThreadPoolMode::GLOBAL_QUEUE, threads, tasks),
+                bench_external<LockFreeThreadPool>(ThreadPoolMode::GLOBAL_QUEUE, threads, tasks),
+                bench_external<ThreadPool>(ThreadPoolMode::WORK_STEALING, threads, tasks));
+    std::printf("%-10s %16.0f %16.0f %16.0f\n", "fork",
+                bench_fork<ThreadPool>(ThreadPoolMode::GLOBAL_QUEUE, threads, tasks),
+                bench_fork<LockFreeThreadPool>(ThreadPoolMode::GLOBAL_QUEUE, threads, tasks),
+                bench_fork<ThreadPool>(ThreadPoolMode::WORK_STEALING, threads, tasks));
+    return 0;
+}
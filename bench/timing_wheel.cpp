@@ -0,0 +1,82 @@
+// idle timeout bookkeeping on every packet: reset the connection's deadline, expire once per event batch
+// std::set ordered by deadline(erase + insert per packet) against the TimingWheel(mostly a store)
+// usage: bench_timing_wheel [open connections] [packets]
+#include <wheel/timing_wheel.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+using Clock = wheel::TimingWheel::Clock;
+using std::chrono::milliseconds;
+
+namespace {
+
+constexpr auto TIMEOUT = milliseconds(5000);
+constexpr int BATCH = 64;  // packets per epoll_wait
+
+// packets arrive one microsecond apart on random connections
+template <typename Reset, typename Expire>
+double ns_per_packet(int open, int packets, Reset reset, Expire expire) {
+    std::mt19937 rng(42);
+    auto t = Clock::now();
+    for (int fd = 0; fd < open; ++fd) {
+        reset(fd, t);
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < packets; ++i) {
+        t += std::chrono::microseconds(1);
+        reset(static_cast<int>(rng() % open), t);
+        if (i % BATCH == 0) {
+            expire(t);
+        }
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / packets;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int open = argc > 1 ? std::atoi(argv[1]) : 10000;
+    int packets = argc > 2 ? std::atoi(argv[2]) : 10000000;
+    size_t expired = 0;
+
+    std::set<std::pair<Clock::time_point, int>> set;
+    std::vector<Clock::time_point> deadlines(open);
+    double set_ns = ns_per_packet(open, packets,
+        [&](int fd, Clock::time_point now) {
+            set.erase({deadlines[fd], fd});
+            deadlines[fd] = now + TIMEOUT;
+            set.emplace(deadlines[fd], fd);
+        },
+        [&](Clock::time_point now) {
+            while (!set.empty() && set.begin()->first <= now) {
+                set.erase(set.begin());
+                ++expired;
+            }
+        });
+
+    wheel::TimingWheel wheel(milliseconds(50), 1024, Clock::now());
+    double wheel_ns = ns_per_packet(open, packets,
+        [&](int fd, Clock::time_point now) { wheel.reset(fd, TIMEOUT, now); },
+        [&](Clock::time_point now) { expired += wheel.expire(now, [](int) {}); });
+
+    // what the server pays on top, once per batch
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < packets / BATCH; ++i) {
+        volatile auto now = Clock::now().time_since_epoch().count();
+        (void)now;
+    }
+    double now_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / packets;
+
+    std::printf("open connections: %d, packets: %d, expired: %zu\n", open, packets, expired);
+    std::printf("%-18s %10s\n", "", "ns/packet");
+    std::printf("%-18s %10.1f\n", "std::set", set_ns);
+    std::printf("%-18s %10.1f\n", "TimingWheel", wheel_ns);
+    std::printf("%-18s %10.1f\n", "Clock::now/batch", now_ns);
+    return 0;
+}
@@ -0,0 +1,101 @@
+// udp packets per second on loopback: clients blast 64 byte datagrams, a Server of DatagramHandlers counts them
+// one datagram per syscall against recvmmsg / sendmmsg batches, and batches with UDP_GRO / UDP_SEGMENT
+// usage: bench_udp [reactors] [clients] [seconds]
+#include <wheel/datagram_handler.hpp>
+#include <wheel/server.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+using wheel::DatagramOptions;
+
+namespace {
+
+constexpr size_t SIZE = 64;
+
+std::atomic<long long> received = 0;
+
+template <unsigned BATCH, bool OFFLOAD>
+class CountHandler : public wheel::DatagramHandler {
+public:
+    CountHandler() : DatagramHandler({.batch = BATCH, .gro = OFFLOAD}) {}
+    ~CountHandler() { received += count_; }
+
+    bool on_datagram(std::span<const char>, const sockaddr_in&) override {
+        ++count_;
+        return true;
+    }
+
+private:
+    long long count_ = 0;
+};
+
+class Sender : public wheel::DatagramHandler {
+public:
+    using DatagramHandler::DatagramHandler;
+    bool on_datagram(std::span<const char>, const sockaddr_in&) override { return true; }
+};
+
+// datagrams per second that arrived
+template <unsigned BATCH, bool OFFLOAD>
+double bench(unsigned short port, int reactors, int clients, double seconds) {
+    received = 0;
+    auto server = std::make_unique<wheel::Server<CountHandler<BATCH, OFFLOAD>>>(
+        wheel::ServerOptions{.mode = wheel::ServerMode::MULTI_REACTOR});
+    std::thread server_thread([&] { server->start(port, reactors); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    std::atomic<bool> stop = false;
+    std::vector<std::thread> workers;
+    for (int i = 0; i < clients; ++i) {
+        workers.emplace_back([&] {
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(port);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            Sender sender(DatagramOptions{.batch = BATCH, .gso = OFFLOAD});
+            wheel::Socket socket;
+            socket.init(SOCK_DGRAM);  // blocking: a full send buffer waits instead of queueing
+            sender.set_socket(std::move(socket));
+            char payload[SIZE] = {};
+            while (!stop.load(std::memory_order_relaxed)) {
+                for (unsigned k = 0; k < (OFFLOAD ? 64 : BATCH); ++k) {
+                    sender.send_to(payload, addr);
+                }
+                sender.flush_datagrams();
+            }
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    server->stop();
+    server_thread.join();
+    server.reset();  // handlers add their counts
+    return received / seconds;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int reactors = argc > 1 ? std::atoi(argv[1]) : 1;
+    int clients = argc > 2 ? std::atoi(argv[2]) : 1;
+    double seconds = argc > 3 ? std::atof(argv[3]) : 2;
+
+    std::printf("reactors: %d, clients: %d, %zu byte datagrams\n", reactors, clients, SIZE);
+    std::printf("%-18s %12s\n", "", "packets/s");
+    std::printf("%-18s %12.0f\n", "1 per syscall", bench<1, false>(19601, reactors, clients, seconds));
+    std::printf("%-18s %12.0f\n", "mmsg batch 64", bench<64, false>(19602, reactors, clients, seconds));
+    std::printf("%-18s %12.0f\n", "batch + gro/gso", bench<64, true>(19603, reactors, clients, seconds));
+    return 0;
+}
@@ -0,0 +1,108 @@
+// ping-pong latency through one MULTI_REACTOR echo server: tcp loopback against AF_UNIX stream(file path and
+// abstract namespace) and seqpacket, one connection, the next message only after the previous echo
+// usage: bench_unix [round trips] [message bytes]
+#include <wheel/histogram.hpp>
+#include <wheel/server.hpp>
+#include <wheel/socket.hpp>
+#include <wheel/stream_handler.hpp>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using wheel::ServerMode;
+
+namespace {
+
+class EchoHandler : public wheel::StreamHandler {
+public:
+    bool on_recv(std::span<const char> data, std::string& reply) override {
+        reply.append(data.data(), data.size());
+        return true;
+    }
+};
+
+// unix_path empty: tcp on port
+bool connect_to(wheel::Socket& socket, const std::string& unix_path, int type, unsigned short port) {
+    for (int i = 0; i < 100; ++i) {
+        bool ok = unix_path.empty() ? socket.init(SOCK_STREAM) && socket.connect("127.0.0.1", port)
+                                    : socket.init(type, AF_UNIX) && socket.connect_unix(unix_path);
+        if (ok) {
+            if (unix_path.empty()) {
+                int one = 1;
+                setsockopt(socket.fd(), IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+            }
+            return true;
+        }
+        socket.close();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));  // server still starting
+    }
+    return false;
+}
+
+void bench(const char* name, std::string unix_path, int type, unsigned short port, int round_trips, size_t size) {
+    wheel::Server<EchoHandler> server({.mode = ServerMode::MULTI_REACTOR, .unix_path = unix_path, .unix_type = type});
+    std::thread server_thread([&] { server.start(port, 1); });
+
+    wheel::Socket socket;
+    if (!connect_to(socket, unix_path, type, port)) {
+        std::printf("%-20s connect failed\n", name);
+        server.stop();
+        server_thread.join();
+        return;
+    }
+    std::string message(size, 'x');
+    std::vector<char> buf(size);
+    wheel::Histogram histogram;
+    for (int i = 0; i < round_trips + round_trips / 10; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        if (socket.send(message) != static_cast<int>(size)) {
+            break;
+        }
+        size_t received = 0;
+        while (received < size) {
+            int n = ::recv(socket.fd(), buf.data() + received, size - received, 0);
+            if (n <= 0) {
+                break;
+            }
+            received += n;
+        }
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+        if (i >= round_trips / 10) {  // the first tenth warms up
+            histogram.record(ns.count());
+        }
+    }
+    socket.close();
+    server.stop();
+    server_thread.join();
+    if (!unix_path.empty() && unix_path[0] != '@') {
+        unlink(unix_path.c_str());
+    }
+    std::printf("%-20s %10.2f %10.2f %10.2f %10.2f\n", name, histogram.mean() / 1000,
+                histogram.percentile(0.5) / 1000.0, histogram.percentile(0.99) / 1000.0,
+                histogram.percentile(0.999) / 1000.0);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int round_trips = argc > 1 ? std::atoi(argv[1]) : 100000;
+    size_t size = argc > 2 ? std::atoi(argv[2]) : 64;
+
+    std::string suffix = std::to_string(getpid());
+    std::printf("round trips: %d, %zu byte messages, latency in us\n", round_trips, size);
+    std::printf("%-20s %10s %10s %10s %10s\n", "transport", "mean", "p50", "p99", "p99.9");
+    bench("tcp loopback", "", SOCK_STREAM, 19011, round_trips, size);
+    bench("unix stream", "/tmp/bench_unix_" + suffix + ".sock", SOCK_STREAM, 0, round_trips, size);
+    bench("unix abstract", "@bench_unix_" + suffix, SOCK_STREAM, 0, round_trips, size);
+    bench("unix seqpacket", "@bench_unix_seq_" + suffix, SOCK_SEQPACKET, 0, round_trips, size);
+    return 0;
+}
@@ -0,0 +1,186 @@
+// a proxy in front of an echo backend, round trips per second through it:
+// blocking: THREAD_POOL handler connects to the backend for every request and waits for the answer on its worker
+// pooled: MULTI_REACTOR handler sends on a pooled upstream connection of its reactor, the answer comes in
+// through the same loop
+// usage: bench_upstream [threads] [connections] [seconds]
+#include <wheel/connection_pool.hpp>
+#include <wheel/server.hpp>
+#include <wheel/socket.hpp>
+#include <wheel/stream_handler.hpp>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using wheel::ServerMode;
+
+namespace {
+
+constexpr unsigned short BACKEND_PORT = 19031;
+constexpr size_t MESSAGE = 64;
+
+class EchoHandler : public wheel::StreamHandler {
+public:
+    bool on_recv(std::span<const char> data, std::string& reply) override {
+        reply.append(data.data(), data.size());
+        return true;
+    }
+};
+
+class BlockingProxy : public wheel::StreamHandler {
+public:
+    bool on_recv(std::span<const char> data, std::string& reply) override {
+        wheel::Socket backend;
+        if (!backend.init(SOCK_STREAM) || !backend.connect("127.0.0.1", BACKEND_PORT)
+            || backend.send({data.data(), data.size()}) != static_cast<int>(data.size())) {
+            return false;
+        }
+        char buf[MESSAGE];
+        for (size_t received = 0; received < data.size();) {
+            int n = ::recv(backend.fd(), buf, sizeof buf, 0);
+            if (n <= 0) {
+                return false;
+            }
+            reply.append(buf, n);
+            received += n;
+        }
+        return true;
+    }
+};
+
+class PooledProxy;
+
+// answers go to the client connection that asked
+class Upstream : public wheel::UpstreamHandler {
+public:
+    bool process() override;
+
+    PooledProxy* client = nullptr;
+    size_t expected = 0;
+};
+
+class PooledProxy : public wheel::StreamHandler {
+public:
+    bool on_recv(std::span<const char> data, std::string&) override {
+        std::string request(data.data(), data.size());
+        auto* pool = wheel::ConnectionPool::local();
+        pool->acquire<Upstream>({"127.0.0.1", BACKEND_PORT}, [this, pool, request](Upstream* upstream) {
+            if (!upstream) {
+                return;
+            }
+            upstream->client = this;
+            upstream->expected = request.size();
+            upstream->write(request);
+            pool->flush(upstream);
+        });
+        return true;
+    }
+};
+
+bool Upstream::process() {
+    char buf[MESSAGE];
+    int n;
+    while ((n = ::recv(socket_.fd(), buf, sizeof buf, 0)) > 0) {
+        client->write({buf, static_cast<size_t>(n)});
+        expected -= std::min<size_t>(n, expected);
+    }
+    if (expected == 0) {
+        client->flush();  // small, the socket takes it
+        wheel::ConnectionPool::local()->release(this);
+    }
+    return n == -1;
+}
+
+int connect_to(unsigned short port) {
+    for (int i = 0; i < 100; ++i) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) == 0) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+            return fd;
+        }
+        close(fd);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));  // server still starting
+    }
+    return -1;
+}
+
+template <typename Proxy>
+void bench(const char* name, ServerMode mode, unsigned short port, int threads, int connections, double seconds) {
+    wheel::Server<Proxy> proxy({.mode = mode, .accepted_socket = {.nodelay = true}});
+    std::thread proxy_thread([&] { proxy.start(port, threads); });
+
+    std::atomic<bool> stop = false;
+    std::atomic<long long> round_trips = 0;
+    std::vector<std::thread> clients;
+    for (int i = 0; i < connections; ++i) {
+        clients.emplace_back([&] {
+            int fd = connect_to(port);
+            if (fd < 0) {
+                return;
+            }
+            char buf[MESSAGE] = {};
+            long long count = 0;
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (send(fd, buf, sizeof buf, MSG_NOSIGNAL) != sizeof buf) {
+                    break;
+                }
+                size_t received = 0;
+                while (received < sizeof buf) {
+                    int n = recv(fd, buf + received, sizeof buf - received, 0);
+                    if (n <= 0) {
+                        break;
+                    }
+                    received += n;
+                }
+                if (received < sizeof buf) {
+                    break;
+                }
+                ++count;
+            }
+            round_trips += count;
+            close(fd);
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    stop = true;
+    for (auto& client : clients) {
+        client.join();
+    }
+    proxy.stop();
+    proxy_thread.join();
+    std::printf("%-10s %12.0f\n", name, round_trips / seconds);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    int threads = argc > 1 ? std::atoi(argv[1]) : static_cast<int>(std::thread::hardware_concurrency());
+    int connections = argc > 2 ? std::atoi(argv[2]) : 16;
+    double seconds = argc > 3 ? std::atof(argv[3]) : 3;
+
+    wheel::Server<EchoHandler> backend({.mode = ServerMode::MULTI_REACTOR, .accepted_socket = {.nodelay = true}});
+    std::thread backend_thread([&] { backend.start(BACKEND_PORT, 1); });
+
+    std::printf("threads: %d, connections: %d, %zu byte messages\n", threads, connections, MESSAGE);
+    std::printf("%-10s %12s\n", "proxy", "round trip/s");
+    bench<BlockingProxy>("blocking", ServerMode::THREAD_POOL, 19032, threads, connections, seconds);
+    bench<PooledProxy>("pooled", ServerMode::MULTI_REACTOR, 19033, threads, connections, seconds);
+
+    backend.stop();
+    backend_thread.join();
+    return 0;
+}
@@ -0,0 +1,105 @@
+// large payload throughput of the SocketHandler output queue over tcp loopback:
+// write(copied into the queue, then send), write_zerocopy(MSG_ZEROCOPY) and write_file(sendfile)
+// note: on loopback the kernel copies zerocopy pages anyway and says so, the handler then falls back to
+// plain sends of the shared buffer(still no copy into the queue), the real win needs a NIC
+// usage: bench_zerocopy [total MiB per run]
+#include <wheel/socket_handler.hpp>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace {
+
+class Sender : public wheel::SocketHandler {
+public:
+    bool process() override { return true; }
+};
+
+enum class Method { SEND, ZEROCOPY, SENDFILE };
+
+std::pair<int, int> tcp_pair() {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof addr;
+    bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof addr);
+    listen(listener, 1);
+    getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len);
+    int sender = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    connect(sender, reinterpret_cast<sockaddr*>(&addr), sizeof addr);
+    int receiver = accept(listener, nullptr, nullptr);
+    close(listener);
+    return {sender, receiver};
+}
+
+// GiB/s
+double run(Method method, size_t payload, size_t total, int file_fd) {
+    auto [fd, receiver] = tcp_pair();
+    std::thread drain([receiver] {
+        static char buf[1 << 20];
+        while (::read(receiver, buf, sizeof buf) > 0) {}
+        close(receiver);
+    });
+
+    Sender sender;
+    sender.set_socket(wheel::Socket::adopt(fd));
+    auto blob = std::make_shared<const std::string>(payload, 'x');
+    auto start = std::chrono::steady_clock::now();
+    for (size_t sent = 0; sent < total; sent += payload) {
+        switch (method) {
+            case Method::SEND: sender.write(*blob); break;
+            case Method::ZEROCOPY: sender.write_zerocopy(blob); break;
+            case Method::SENDFILE: sender.write_file(file_fd, 0, payload); break;
+        }
+        // keep one payload queued at most, like a handler streaming blobs
+        while (sender.pending_output() > 0) {
+            if (!sender.flush()) {
+                std::perror("flush");
+                std::exit(1);
+            }
+            if (sender.pending_output() > 0) {
+                pollfd pfd{.fd = fd, .events = POLLOUT, .revents = 0};
+                poll(&pfd, 1, 100);
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    shutdown(fd, SHUT_WR);
+    drain.join();
+    return total / seconds / (1 << 30);
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    size_t total = (argc > 1 ? std::atol(argv[1]) : 1024) << 20;
+
+    size_t max_payload = 16 << 20;
+    FILE* file = std::tmpfile();
+    std::string data(max_payload, 'f');
+    std::fwrite(data.data(), 1, data.size(), file);
+    std::fflush(file);
+
+    std::printf("%lu MiB per run, GiB/s\n", total >> 20);
+    std::printf("%-10s %10s %10s %10s\n", "payload", "send", "zerocopy", "sendfile");
+    for (size_t payload : {size_t(64) << 10, size_t(1) << 20, size_t(16) << 20}) {
+        std::printf("%-10s %10.2f %10.2f %10.2f\n",
+                    payload < (1 << 20) ? (std::to_string(payload >> 10) + " KiB").c_str() : (std::to_string(payload >> 20) + " MiB").c_str(),
+                    run(Method::SEND, payload, total, fileno(file)),
+                    run(Method::ZEROCOPY, payload, total, fileno(file)),
+                    run(Method::SENDFILE, payload, total, fileno(file)));
+    }
+    std::fclose(file);
+    return 0;
+}
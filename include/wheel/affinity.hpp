@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace wheel {
+
+// "0-3,8,10-11" -> {0, 1, 2, 3, 8, 10, 11}, the format of /sys/devices/system/node/node*/cpulist
+std::vector<int> parse_cpu_list(std::string_view list);
+
+// cpus this process may run on grouped by NUMA node(index is the node id)
+// read once from /sys/devices/system/node, a single node with every cpu when that is missing
+const std::vector<std::vector<int>>& numa_nodes();
+int numa_node_of(int cpu);  // -1 if unknown
+int current_cpu();
+
+// calling thread only
+bool set_thread_affinity(const std::vector<int>& cpus);
+bool set_thread_name(std::string_view name);  // truncated to 15 chars
+
+enum class Placement : uint8_t {
+    NONE,  // the OS decides
+    CPU_SET,  // every worker may run on any of cpus
+    SPREAD,  // one cpu per worker, round robin over the nodes
+    PACK,  // one cpu per worker, fill a node before using the next one
+};
+
+struct PlacementPolicy {
+    Placement placement = Placement::NONE;
+    std::vector<int> cpus{};  // allowed cpus, empty means every cpu of numa_nodes()
+    int node = -1;  // CPU_SET: only this node, PACK: start on this node, -1 means no preference
+    std::string name{};  // workers are named "<name>/<index>", empty keeps the inherited name
+
+    // cpus the index-th worker is pinned to, empty means not pinned
+    std::vector<int> cpus_for(int index, const std::vector<std::vector<int>>& nodes = numa_nodes()) const;
+};
+
+}  // namespace wheel
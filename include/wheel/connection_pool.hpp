@@ -0,0 +1,155 @@
+#pragma once
+
+#include <wheel/epoll.hpp>
+#include <wheel/socket_handler.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace wheel {
+
+// where a ConnectionPool connects to, its connections are pooled by key()
+struct Endpoint {
+    std::string address;  // ipv4 / ipv6 address, or with port 0 an AF_UNIX path("@name" for the abstract namespace)
+    unsigned short port = 0;
+
+    std::string key() const { return address + ':' + std::to_string(port); }
+};
+
+struct PoolOptions {
+    size_t max_idle = 8;  // per endpoint, a connection released beyond it is closed
+    // per endpoint(connecting, in use and idle), further acquires wait for a release, 0 is unlimited
+    size_t max_connections = 0;
+    size_t max_uses = 0;  // acquires of one connection, closed on the release after the last, 0 is unlimited
+    std::chrono::milliseconds idle_timeout{60000};  // idle longer is closed, 0 keeps it
+    std::chrono::milliseconds connect_timeout{5000};  // 0 waits for the kernel to give up
+    // reuse the most recently released connection(its peer is most likely still there, the rest ages out),
+    // false takes the oldest and spreads the use over all of them
+    bool lifo = true;
+    // an idle connection is peeked at(recv MSG_PEEK) before reuse: closed by the peer or with unasked for data
+    // it is dropped, the events of idle connections catch most of them already
+    bool health_check = true;
+};
+
+class ConnectionPool;
+
+// outbound connection of a ConnectionPool, subclass it with the protocol's process()(reads the responses)
+// the pool owns it, between acquires it stays with its socket for the next one of the same endpoint
+class UpstreamHandler : public SocketHandler {
+public:
+    UpstreamHandler() = default;
+    virtual ~UpstreamHandler() = default;
+
+    bool upstream() const override { return true; }
+    // the socket failed or the peer closed while in use, the pool closes it after this returned
+    virtual void on_close() {}
+
+    const std::string& key() const { return key_; }
+    // acquires of this connection so far
+    size_t uses() const { return uses_; }
+
+private:
+    friend class ConnectionPool;
+    enum class State : uint8_t { CONNECTING, IN_USE, IDLE, CLOSED };
+
+    State state_ = State::CONNECTING;
+    std::string key_;
+    size_t uses_ = 0;
+    uint64_t ticket_ = 0;  // the acquire waiting for the connect
+    std::chrono::steady_clock::time_point since_;  // connect started, or released
+};
+
+// keyed pool of outbound connections, driven by the epoll loop of one thread(Server: every reactor has one,
+// see local()): connects do not block, they complete when the loop reports the socket writable
+// only the thread running the loop may use it
+// one UpstreamHandler type per endpoint, an idle connection is handed to whoever acquires the endpoint next
+class ConnectionPool {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Factory = std::function<std::unique_ptr<UpstreamHandler>()>;
+    // the connection, null if the connect failed or timed out
+    using Callback = std::function<void(UpstreamHandler*)>;
+
+    explicit ConnectionPool(Epoll& epoll, PoolOptions options = {});
+    ~ConnectionPool();
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    // done gets an idle connection right away(before acquire returns), a new one once the connect completed,
+    // or with max_connections in use the next one released; a failed connect is reported the same way
+    // the connection is the caller's until release(), returns a ticket for cancel()
+    template <typename T> requires std::is_base_of_v<UpstreamHandler, T>
+    uint64_t acquire(const Endpoint& endpoint, std::function<void(T*)> done) {
+        return acquire_(endpoint, [] { return std::make_unique<T>(); },
+                        [done = std::move(done)](UpstreamHandler* handler) { done(static_cast<T*>(handler)); });
+    }
+    // done will not be called(the caller went away), a connection that was coming for it goes idle
+    bool cancel(uint64_t ticket);
+    // back to the idle ones, or closed: reusable false(a response not read to its end), output still queued,
+    // max_uses or max_idle reached; a waiting acquire takes it over
+    void release(UpstreamHandler* handler, bool reusable = true);
+    // send what handler->write() queued, the rest when the socket is writable, false(and closed) on an error
+    bool flush(UpstreamHandler* handler);
+
+    // the loop: events of an UpstreamHandler(SocketHandler::upstream() is true)
+    void handle(UpstreamHandler* handler, uint32_t events);
+    // the loop, after every batch of events: timeouts, and frees the closed handlers(the batch may still
+    // have pointed at them)
+    void expire(Clock::time_point now);
+    // until the next timeout, -1 if none
+    int next_timeout_ms(Clock::time_point now) const;
+
+    // connections, connecting and in use included
+    size_t size() const { return size_; }
+    size_t idle(const Endpoint& endpoint) const;
+    // nothing for expire() to do
+    bool empty() const { return size_ == 0 && closed_.empty(); }
+
+    // the pool of the loop running on this thread(set by Server for its reactors), null if none
+    static ConnectionPool* local();
+    static void set_local(ConnectionPool* pool);
+
+private:
+    struct Waiter {
+        uint64_t ticket;
+        Factory factory;
+    };
+    struct Key {
+        Endpoint endpoint;
+        std::deque<UpstreamHandler*> idle;  // released last at the back
+        std::deque<Waiter> waiters;  // max_connections reached
+        size_t total = 0;
+    };
+
+    uint64_t acquire_(const Endpoint& endpoint, Factory factory, Callback done);
+    void connect_(Key& key, uint64_t ticket, Factory& factory);
+    void connected_(UpstreamHandler* handler);
+    // calls the callback of ticket(if still wanted) with handler, an unwanted handler is released
+    void finish_(uint64_t ticket, UpstreamHandler* handler);
+    void close_(UpstreamHandler* handler);
+    // a waiter gets a new connection if a slot became free
+    void serve_waiters_(Key& key);
+    bool healthy_(UpstreamHandler* handler);
+    void update_events_(UpstreamHandler* handler);
+    void schedule_(Clock::time_point deadline);
+
+    Epoll& epoll_;
+    PoolOptions options_;
+    std::unordered_map<std::string, Key> keys_;
+    std::vector<std::unique_ptr<UpstreamHandler>> handlers_;  // by fd
+    std::vector<std::unique_ptr<UpstreamHandler>> closed_;  // freed by expire()
+    std::vector<UpstreamHandler*> connecting_;
+    std::unordered_map<uint64_t, Callback> pending_;  // by ticket, acquires not served yet
+    uint64_t next_ticket_ = 0;
+    size_t size_ = 0;
+    Clock::time_point next_expire_ = Clock::time_point::max();
+};
+
+}  // namespace wheel
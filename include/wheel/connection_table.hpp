@@ -0,0 +1,73 @@
+#pragma once
+
+#include <wheel/socket_handler.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace wheel {
+
+// fd indexed handlers of one reactor, only the reactor thread inserts and erases
+// handler storage is recycled: erase destroys the handler in place and keeps its block for the next
+// connection, so once the table is warm accepting does not go to the allocator
+class ConnectionTable {
+public:
+    // blocks fit any handler up to block_size, capacity blocks and slots are allocated up front
+    ConnectionTable(size_t block_size, size_t block_align, size_t capacity);
+    ~ConnectionTable();
+    ConnectionTable(const ConnectionTable&) = delete;
+    ConnectionTable& operator=(const ConnectionTable&) = delete;
+
+    // replaces a handler still registered under fd
+    template <typename T, typename... Args> requires std::is_base_of_v<SocketHandler, T>
+    T* emplace(int fd, Args&&... args) {
+        if (sizeof(T) > block_size_ || alignof(T) > block_align_) {
+            throw std::length_error("ConnectionTable: handler does not fit the blocks");
+        }
+        if (static_cast<size_t>(fd) >= slots_.size()) {
+            slots_.resize(std::max<size_t>(fd + 1, slots_.size() * 2), nullptr);
+        }
+        erase(fd);
+        void* block = take_();
+        T* handler;
+        try {
+            handler = new (block) T(std::forward<Args>(args)...);
+        } catch (...) {
+            free_.push_back(block);
+            throw;
+        }
+        slots_[fd] = handler;
+        ++size_;
+        return handler;
+    }
+
+    SocketHandler* find(int fd) const {
+        return fd >= 0 && static_cast<size_t>(fd) < slots_.size() ? slots_[fd] : nullptr;
+    }
+    bool erase(int fd);
+
+    size_t size() const { return size_; }
+    // blocks allocated so far
+    size_t capacity() const { return blocks_; }
+
+    static constexpr size_t CHUNK = 64;  // blocks per allocation once the preallocated ones are used
+
+private:
+    void* take_();
+    void allocate_(size_t count);
+
+    size_t block_size_;
+    size_t block_align_;
+    std::vector<SocketHandler*> slots_;  // by fd
+    std::vector<void*> free_;  // recycled blocks
+    std::vector<void*> chunks_;
+    size_t blocks_ = 0;
+    size_t size_ = 0;
+};
+
+}  // namespace wheel
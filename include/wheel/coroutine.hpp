@@ -0,0 +1,389 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>  // std::monostate
+#include <vector>
+
+#include <wheel/free_list.hpp>
+#include <wheel/future.hpp>
+
+namespace wheel {
+
+// lazy coroutine: starts when awaited, resumes its awaiter by symmetric transfer when done,
+// so awaiting chains of any depth run in constant stack
+// frames come from per thread free lists(64 B ~ 2 KiB classes)
+//
+//     task<int> handle(ThreadPool& pool) {
+//         co_await pool.schedule();  // now on a worker
+//         co_return co_await compute();
+//     }
+template <typename T = void>
+class task;
+
+namespace detail {
+
+inline constexpr size_t MAX_POOLED_FRAME = 2048;
+
+template <size_t SIZE = 64>
+void* allocate_frame(size_t size) {
+    if constexpr (SIZE > MAX_POOLED_FRAME) {
+        return ::operator new(size);
+    } else {
+        return size <= SIZE ? FreeList<SIZE>::allocate() : allocate_frame<SIZE * 2>(size);
+    }
+}
+
+template <size_t SIZE = 64>
+void deallocate_frame(void* p, size_t size) {
+    if constexpr (SIZE > MAX_POOLED_FRAME) {
+        ::operator delete(p);
+    } else {
+        size <= SIZE ? FreeList<SIZE>::deallocate(p) : deallocate_frame<SIZE * 2>(p, size);
+    }
+}
+
+struct PooledFrame {
+    static void* operator new(size_t size) { return allocate_frame(size); }
+    static void operator delete(void* p, size_t size) { deallocate_frame(p, size); }
+};
+
+template <typename T>
+using non_void_t = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+class TaskPromiseBase : public PooledFrame {
+public:
+    struct FinalAwaiter {
+        bool await_ready() const noexcept { return false; }
+        template <typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+            return handle.promise().continuation_;
+        }
+        void await_resume() const noexcept {}
+    };
+
+    std::suspend_always initial_suspend() const noexcept { return {}; }
+    FinalAwaiter final_suspend() const noexcept { return {}; }
+    void unhandled_exception() { exception_ = std::current_exception(); }
+
+    void set_continuation(std::coroutine_handle<> continuation) { continuation_ = continuation; }
+
+protected:
+    std::coroutine_handle<> continuation_ = std::noop_coroutine();
+    std::exception_ptr exception_;
+};
+
+template <typename T>
+class TaskPromise : public TaskPromiseBase {
+public:
+    task<T> get_return_object() noexcept;
+
+    template <typename U> requires std::is_convertible_v<U&&, T>
+    void return_value(U&& value) {
+        value_.emplace(std::forward<U>(value));
+    }
+
+    T result() {
+        if (exception_) {
+            std::rethrow_exception(exception_);
+        }
+        return std::move(*value_);
+    }
+
+private:
+    std::optional<T> value_;
+};
+
+template <>
+class TaskPromise<void> : public TaskPromiseBase {
+public:
+    task<void> get_return_object() noexcept;
+
+    void return_void() const noexcept {}
+
+    void result() {
+        if (exception_) {
+            std::rethrow_exception(exception_);
+        }
+    }
+};
+
+// fire and forget coroutine used to start tasks, destroys itself when done
+// and then transfers to the handle it co_returns
+class Detached {
+public:
+    struct promise_type : PooledFrame {
+        Detached get_return_object() noexcept { return Detached{std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_always initial_suspend() const noexcept { return {}; }
+        auto final_suspend() const noexcept {
+            struct Awaiter {
+                bool await_ready() const noexcept { return false; }
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+                    auto next = handle.promise().next;
+                    handle.destroy();
+                    return next;
+                }
+                void await_resume() const noexcept {}
+            };
+            return Awaiter{};
+        }
+        void return_value(std::coroutine_handle<> handle) noexcept { next = handle; }
+        void unhandled_exception() const noexcept { std::terminate(); }
+
+        std::coroutine_handle<> next = std::noop_coroutine();
+    };
+
+    void start() { handle_.resume(); }
+
+private:
+    explicit Detached(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+// the awaiter holds one extra count, so children finishing while it is still starting them
+// can not resume it before it has suspended
+class Latch {
+public:
+    explicit Latch(size_t count) : count_(count + 1) {}
+
+    // a child is done, the last one gets the continuation to transfer to
+    std::coroutine_handle<> arrive() noexcept {
+        return count_.fetch_sub(1, std::memory_order_acq_rel) == 1 ? continuation_ : std::noop_coroutine();
+    }
+
+    // the awaiter has started every child, true if it has to suspend
+    bool try_await(std::coroutine_handle<> continuation) noexcept {
+        continuation_ = continuation;
+        return count_.fetch_sub(1, std::memory_order_acq_rel) > 1;
+    }
+
+private:
+    std::atomic<size_t> count_;
+    std::coroutine_handle<> continuation_;
+};
+
+template <typename T>
+struct Result {
+    std::optional<non_void_t<T>> value;
+    std::exception_ptr exception;
+
+    non_void_t<T> get() {
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+        return std::move(*value);
+    }
+};
+
+template <typename T>
+Detached run_child(task<T>& child, Result<T>& result, Latch& latch);
+
+// start children and suspend until the latch opens
+template <typename Start>
+struct LatchAwaiter {
+    Latch& latch;
+    Start start;
+
+    bool await_ready() const noexcept { return false; }
+    bool await_suspend(std::coroutine_handle<> handle) {
+        start();
+        return latch.try_await(handle);
+    }
+    void await_resume() const noexcept {}
+};
+
+template <typename Start>
+LatchAwaiter(Latch&, Start) -> LatchAwaiter<Start>;
+
+}  // namespace detail
+
+template <typename T>
+class [[nodiscard]] task {
+public:
+    using promise_type = detail::TaskPromise<T>;
+    using value_type = T;
+
+    task() = default;
+    task(task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+    task& operator=(task&& other) noexcept {
+        if (this != &other) {
+            if (handle_) {
+                handle_.destroy();
+            }
+            handle_ = std::exchange(other.handle_, nullptr);
+        }
+        return *this;
+    }
+    ~task() {
+        if (handle_) {
+            handle_.destroy();
+        }
+    }
+
+    task(const task&) = delete;
+    task& operator=(const task&) = delete;
+
+    bool valid() const { return handle_ != nullptr; }
+    bool done() const { return handle_.done(); }
+
+    // start this task and suspend the awaiter until it is done
+    auto operator co_await() noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> handle;
+
+            bool await_ready() const noexcept { return handle.done(); }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+                handle.promise().set_continuation(awaiter);
+                return handle;
+            }
+            T await_resume() { return handle.promise().result(); }
+        };
+        return Awaiter{handle_};
+    }
+
+private:
+    friend class detail::TaskPromise<T>;
+
+    explicit task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+
+    std::coroutine_handle<promise_type> handle_;
+};
+
+namespace detail {
+
+template <typename T>
+task<T> TaskPromise<T>::get_return_object() noexcept {
+    return task<T>(std::coroutine_handle<TaskPromise>::from_promise(*this));
+}
+
+inline task<void> TaskPromise<void>::get_return_object() noexcept {
+    return task<void>(std::coroutine_handle<TaskPromise>::from_promise(*this));
+}
+
+template <typename T>
+Detached run_child(task<T>& child, Result<T>& result, Latch& latch) {
+    try {
+        if constexpr (std::is_void_v<T>) {
+            co_await child;
+            result.value.emplace();
+        } else {
+            result.value.emplace(co_await child);
+        }
+    } catch (...) {
+        result.exception = std::current_exception();
+    }
+    co_return latch.arrive();
+}
+
+}  // namespace detail
+
+// block the calling thread until t is done
+template <typename T>
+T sync_wait(task<T> t) {
+    Promise<T> promise;
+    auto future = promise.get_future();
+    [](task<T> t, Promise<T> promise) -> detail::Detached {
+        try {
+            if constexpr (std::is_void_v<T>) {
+                co_await t;
+                promise.set_value();
+            } else {
+                promise.set_value(co_await t);
+            }
+        } catch (...) {
+            promise.set_exception(std::current_exception());
+        }
+        co_return std::noop_coroutine();
+    }(std::move(t), std::move(promise)).start();
+    return future.get();
+}
+
+// run every task concurrently(each runs where it schedules itself), resume when all are done
+// the first exception is rethrown after all of them finished
+template <typename T>
+task<std::conditional_t<std::is_void_v<T>, void, std::vector<T>>> when_all(std::vector<task<T>> tasks) {
+    detail::Latch latch(tasks.size());
+    std::vector<detail::Result<T>> results(tasks.size());
+    co_await detail::LatchAwaiter{latch, [&] {
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            detail::run_child(tasks[i], results[i], latch).start();
+        }
+    }};
+
+    if constexpr (std::is_void_v<T>) {
+        for (auto& result : results) {
+            result.get();
+        }
+    } else {
+        std::vector<T> values;
+        values.reserve(results.size());
+        for (auto& result : results) {
+            values.emplace_back(result.get());
+        }
+        co_return values;
+    }
+}
+
+// void results become std::monostate
+template <typename ...Ts>
+task<std::tuple<detail::non_void_t<Ts>...>> when_all(task<Ts> ...tasks) {
+    detail::Latch latch(sizeof...(Ts));
+    std::tuple<detail::Result<Ts>...> results;
+    co_await detail::LatchAwaiter{latch, [&] {
+        std::apply([&](auto& ...result) { (detail::run_child(tasks, result, latch).start(), ...); }, results);
+    }};
+    co_return std::apply([](auto& ...result) { return std::tuple<detail::non_void_t<Ts>...>(result.get()...); }, results);
+}
+
+// resume with (index, value) of the first task that finishes, tasks must not be empty
+// the others keep running to completion in the background
+template <typename T>
+task<std::pair<size_t, detail::non_void_t<T>>> when_any(std::vector<task<T>> tasks) {
+    struct State {
+        explicit State(std::vector<task<T>>&& tasks) : tasks(std::move(tasks)), latch(1) {}
+
+        std::vector<task<T>> tasks;  // owned here, losers may finish after when_any returned
+        detail::Latch latch;
+        std::atomic<bool> finished = false;
+        size_t index = 0;
+        detail::Result<T> result;
+    };
+    auto state = std::make_shared<State>(std::move(tasks));
+
+    auto run = [](std::shared_ptr<State> state, size_t index) -> detail::Detached {
+        detail::Result<T> result;
+        try {
+            if constexpr (std::is_void_v<T>) {
+                co_await state->tasks[index];
+                result.value.emplace();
+            } else {
+                result.value.emplace(co_await state->tasks[index]);
+            }
+        } catch (...) {
+            result.exception = std::current_exception();
+        }
+        if (state->finished.exchange(true, std::memory_order_acq_rel)) {
+            co_return std::noop_coroutine();
+        }
+        state->index = index;
+        state->result = std::move(result);
+        co_return state->latch.arrive();
+    };
+    co_await detail::LatchAwaiter{state->latch, [&] {
+        for (size_t i = 0; i < state->tasks.size(); ++i) {
+            run(state, i).start();
+        }
+    }};
+
+    co_return std::pair<size_t, detail::non_void_t<T>>(state->index, state->result.get());
+}
+
+}  // namespace wheel
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <wheel/socket_handler.hpp>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace wheel {
+
+struct DatagramOptions {
+    unsigned batch = 64;  // datagrams per recvmmsg / sendmmsg
+    size_t max_datagram = 2048;  // receive buffer of one datagram, longer ones are dropped
+    // UDP_GRO: the kernel hands over a flow's datagrams coalesced, a receive buffer holds up to 64 KiB of them
+    bool gro = false;
+    // UDP_SEGMENT: consecutive equal size datagrams to one peer go down the stack as one
+    bool gso = false;
+};
+
+// udp handler, for Server(one bound socket per reactor, nothing to accept) or a bare Epoll
+// datagrams come and go in batches: recvmmsg into buffers allocated up front, sendmmsg from a send queue
+class DatagramHandler : public SocketHandler {
+public:
+    explicit DatagramHandler(DatagramOptions options = {});
+    virtual ~DatagramHandler() = default;
+
+    // recvmmsg until the socket is drained, on_datagram for each datagram, then flush_datagrams()
+    bool process() override;
+    // data points into the receive buffers, only valid during the call
+    // return false to stop the handler(the server closes the socket)
+    virtual bool on_datagram(std::span<const char> data, const sockaddr_in& peer) = 0;
+    // the rest of the queue, the server waits for EPOLLOUT while datagrams are pending
+    bool on_writable() override { return flush_datagrams(); }
+
+    // queued, sent by flush_datagrams(after process() returned, or call it)
+    void send_to(std::span<const char> data, const sockaddr_in& peer);
+    // sendmmsg batches, what the socket does not take now(EAGAIN / ENOBUFS) stays queued for the next flush
+    // a datagram the kernel refuses is dropped, false only if the socket is unusable
+    bool flush_datagrams();
+    size_t pending_datagrams() const { return queue_.size() - queue_head_; }
+
+    static constexpr size_t GRO_BUFFER = 65535;
+    static constexpr size_t GSO_MAX_BYTES = 65000;  // of one segmented send, below the ip limit with headers
+    static constexpr size_t GSO_MAX_SEGMENTS = 64;
+
+private:
+    struct Queued {
+        size_t offset;  // in send_buf_
+        size_t size;
+        sockaddr_in peer;
+    };
+
+    void setup_();
+
+    DatagramOptions options_;
+    bool ready_ = false;  // socket options applied
+    size_t slot_size_;
+
+    // receive, one slot per datagram of a batch
+    std::vector<char> pool_;
+    std::vector<mmsghdr> recv_msgs_;
+    std::vector<iovec> recv_iov_;
+    std::vector<sockaddr_in> recv_peers_;
+    std::vector<char> recv_control_;
+
+    // send
+    std::string send_buf_;
+    std::vector<Queued> queue_;
+    size_t queue_head_ = 0;  // entries before it are sent
+    std::vector<mmsghdr> send_msgs_;
+    std::vector<iovec> send_iov_;
+    std::vector<char> send_control_;
+    std::vector<size_t> send_end_;  // queue index after each message of the batch
+};
+
+}  // namespace wheel
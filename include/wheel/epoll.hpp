@@ -23,6 +23,9 @@ public:
     uint32_t get_events(size_t i) const;
     void* get_ptr(size_t i) const;
 
+    // to wait on this epoll elsewhere(an io_uring poll)
+    int fd() const { return efd_; }
+
 private:
     int efd_;
     std::vector<epoll_event> events_;
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+
+namespace wheel {
+
+// per thread cache of fixed size blocks
+// a block may be freed on any thread, it then joins that thread's cache
+template <size_t SIZE, size_t MAX_CACHED = 1024>
+class FreeList {
+    static_assert(SIZE >= sizeof(void*), "block must hold a pointer");
+
+public:
+    static void* allocate() {
+        Cache& cache = cache_();
+        if (Node* node = cache.head) {
+            cache.head = node->next;
+            --cache.size;
+            return node;
+        }
+        return ::operator new(SIZE);
+    }
+
+    static void deallocate(void* p) {
+        Cache& cache = cache_();
+        if (cache.size < MAX_CACHED) {
+            cache.head = new (p) Node{cache.head};
+            ++cache.size;
+        } else {
+            ::operator delete(p);
+        }
+    }
+
+private:
+    struct Node {
+        Node* next;
+    };
+
+    struct Cache {
+        ~Cache() {
+            while (head) {
+                Node* next = head->next;
+                ::operator delete(head);
+                head = next;
+            }
+        }
+
+        Node* head = nullptr;
+        size_t size = 0;
+    };
+
+    static Cache& cache_() {
+        thread_local Cache cache;
+        return cache;
+    }
+};
+
+}  // namespace wheel
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <future>  // std::future_error
+#include <type_traits>
+#include <utility>
+#include <variant>  // std::monostate
+
+#include <wheel/free_list.hpp>
+
+namespace wheel {
+
+// lightweight std::promise / std::future
+// the value is stored inline in the shared state, the state comes from a per thread free list
+// and waiting uses std::atomic::wait, so a round trip usually does not touch the allocator
+template <typename T>
+class Future;
+
+namespace detail {
+
+template <typename T>
+class SharedState {
+public:
+    using value_type = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+    enum Status : uint32_t {
+        EMPTY,
+        VALUE,
+        EXCEPTION,
+    };
+
+    SharedState() {}
+    ~SharedState() {
+        if (status_.load(std::memory_order_relaxed) == VALUE) {
+            value_.~value_type();
+        }
+    }
+
+    static void* operator new(size_t) { return FreeList<sizeof(SharedState)>::allocate(); }
+    static void operator delete(void* p) { FreeList<sizeof(SharedState)>::deallocate(p); }
+
+    template <typename ...Args>
+    void set_value(Args&& ...args) {
+        new (&value_) value_type(std::forward<Args>(args)...);
+        set_status_(VALUE);
+    }
+
+    void set_exception(std::exception_ptr e) {
+        exception_ = std::move(e);
+        set_status_(EXCEPTION);
+    }
+
+    bool ready() const { return status_.load(std::memory_order_acquire) != EMPTY; }
+    void wait() const { status_.wait(EMPTY, std::memory_order_acquire); }
+
+    value_type get() {
+        wait();
+        if (status_.load(std::memory_order_relaxed) == EXCEPTION) {
+            std::rethrow_exception(exception_);
+        }
+        return std::move(value_);
+    }
+
+    void release() {
+        if (refs_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+
+private:
+    void set_status_(Status status) {
+        status_.store(status, std::memory_order_release);
+        status_.notify_all();
+    }
+
+    std::atomic<uint32_t> status_ = EMPTY;
+    std::atomic<uint32_t> refs_ = 2;  // promise + future
+    union {
+        value_type value_;
+    };
+    std::exception_ptr exception_;
+};
+
+}  // namespace detail
+
+template <typename T>
+class Promise {
+public:
+    Promise() : state_(new detail::SharedState<T>) {}
+    Promise(Promise&& other) noexcept
+        : state_(std::exchange(other.state_, nullptr)), retrieved_(other.retrieved_), satisfied_(other.satisfied_) {}
+    Promise& operator=(Promise&& other) noexcept {
+        if (this != &other) {
+            release_();
+            state_ = std::exchange(other.state_, nullptr);
+            retrieved_ = other.retrieved_;
+            satisfied_ = other.satisfied_;
+        }
+        return *this;
+    }
+    ~Promise() { release_(); }
+
+    Promise(const Promise&) = delete;
+    Promise& operator=(const Promise&) = delete;
+
+    // call once
+    Future<T> get_future() {
+        retrieved_ = true;
+        return Future<T>(state_);
+    }
+
+    template <typename ...Args>
+    void set_value(Args&& ...args) {
+        state_->set_value(std::forward<Args>(args)...);
+        satisfied_ = true;
+    }
+
+    void set_exception(std::exception_ptr e) {
+        state_->set_exception(std::move(e));
+        satisfied_ = true;
+    }
+
+private:
+    void release_() {
+        if (!state_) {
+            return;
+        }
+        if (!satisfied_) {
+            state_->set_exception(std::make_exception_ptr(std::future_error(std::future_errc::broken_promise)));
+        }
+        if (!retrieved_) {
+            state_->release();  // the future's reference
+        }
+        state_->release();
+        state_ = nullptr;
+    }
+
+    detail::SharedState<T>* state_;
+    bool retrieved_ = false;
+    bool satisfied_ = false;
+};
+
+template <typename T>
+class Future {
+    friend class Promise<T>;
+
+public:
+    Future() = default;
+    Future(Future&& other) noexcept : state_(std::exchange(other.state_, nullptr)) {}
+    Future& operator=(Future&& other) noexcept {
+        if (this != &other) {
+            release_();
+            state_ = std::exchange(other.state_, nullptr);
+        }
+        return *this;
+    }
+    ~Future() { release_(); }
+
+    Future(const Future&) = delete;
+    Future& operator=(const Future&) = delete;
+
+    bool valid() const { return state_ != nullptr; }
+    bool ready() const { return state_->ready(); }
+    void wait() const { state_->wait(); }
+
+    // call once
+    T get() {
+        if constexpr (std::is_void_v<T>) {
+            state_->get();
+        } else {
+            return state_->get();
+        }
+    }
+
+private:
+    explicit Future(detail::SharedState<T>* state) : state_(state) {}
+
+    void release_() {
+        if (state_) {
+            state_->release();
+            state_ = nullptr;
+        }
+    }
+
+    detail::SharedState<T>* state_ = nullptr;
+};
+
+}  // namespace wheel
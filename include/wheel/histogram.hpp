@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+
+namespace wheel {
+
+// log linear buckets: 4 buckets per power of 2, so a bucket is at most 25% wide
+// values are usually nanoseconds
+class Histogram {
+public:
+    static constexpr int SUB_BITS = 2;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr int BUCKETS = 64 * SUB_BUCKETS;
+
+    static int bucket_of(uint64_t value) {
+        if (value < SUB_BUCKETS) {
+            return static_cast<int>(value);
+        }
+        int exp = std::bit_width(value) - 1;  // >= SUB_BITS
+        int sub = static_cast<int>(value >> (exp - SUB_BITS)) & (SUB_BUCKETS - 1);
+        return (exp - SUB_BITS + 1) * SUB_BUCKETS + sub;
+    }
+
+    // largest value that falls into the bucket
+    static uint64_t upper_bound_of(int bucket) {
+        if (bucket < SUB_BUCKETS) {
+            return bucket;
+        }
+        int exp = bucket / SUB_BUCKETS + SUB_BITS - 1;
+        uint64_t sub = bucket % SUB_BUCKETS;
+        return ((SUB_BUCKETS + sub + 1) << (exp - SUB_BITS)) - 1;
+    }
+
+    void record(uint64_t value, uint64_t n = 1) {
+        buckets_[bucket_of(value)] += n;
+        count_ += n;
+        sum_ += value * n;
+    }
+
+    // n values in bucket i whose sum is added separately with add_sum, keeps mean() exact
+    void add_bucket(int i, uint64_t n) {
+        buckets_[i] += n;
+        count_ += n;
+    }
+    void add_sum(uint64_t sum) { sum_ += sum; }
+
+    void merge(const Histogram& other) {
+        for (int i = 0; i < BUCKETS; ++i) {
+            buckets_[i] += other.buckets_[i];
+        }
+        count_ += other.count_;
+        sum_ += other.sum_;
+    }
+
+    uint64_t count() const { return count_; }
+    double mean() const { return count_ ? static_cast<double>(sum_) / count_ : 0; }
+    uint64_t bucket(int i) const { return buckets_[i]; }
+
+    // p in [0, 1], an upper bound of the value at that rank
+    uint64_t percentile(double p) const {
+        if (count_ == 0) {
+            return 0;
+        }
+        auto rank = static_cast<uint64_t>(p * (count_ - 1)) + 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; ++i) {
+            seen += buckets_[i];
+            if (seen >= rank) {
+                return upper_bound_of(i);
+            }
+        }
+        return upper_bound_of(BUCKETS - 1);
+    }
+
+    void clear() { *this = Histogram{}; }
+
+private:
+    std::array<uint64_t, BUCKETS> buckets_{};
+    uint64_t count_ = 0;
+    uint64_t sum_ = 0;
+};
+
+// written by one thread, read by any thread
+// the writer uses plain load + store(no locked instruction), readers take a Histogram snapshot
+class ConcurrentHistogram {
+public:
+    void record(uint64_t value) {
+        auto& bucket = buckets_[Histogram::bucket_of(value)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sum_.store(sum_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    // mean() comes from the recorded sum, not the bucket bounds(a record in between the loads may skew it a little)
+    void snapshot_into(Histogram& histogram) const {
+        for (int i = 0; i < Histogram::BUCKETS; ++i) {
+            if (uint64_t n = buckets_[i].load(std::memory_order_relaxed)) {
+                histogram.add_bucket(i, n);
+            }
+        }
+        histogram.add_sum(sum_.load(std::memory_order_relaxed));
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, Histogram::BUCKETS> buckets_{};
+    std::atomic<uint64_t> sum_ = 0;
+};
+
+}  // namespace wheel
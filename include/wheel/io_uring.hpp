@@ -0,0 +1,100 @@
+#pragma once
+
+#include <linux/io_uring.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace wheel {
+
+// thin io_uring wrapper(raw syscalls, no liburing), used by one thread
+// sqes are queued by the prep functions and handed to the kernel by submit_and_wait
+class IoUring {
+public:
+    explicit IoUring(unsigned entries = 256);
+    ~IoUring();
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // setup succeeded
+    bool ok() const { return fd_ != -1; }
+
+    // the kernel has what Server needs: multishot accept / recv / poll, provided buffer rings, shutdown
+    static bool supported();
+
+    // provided buffer ring for multishot recv, count must be a power of 2
+    bool init_buffers(uint16_t group, unsigned count, unsigned size);
+    std::span<const char> buffer(uint16_t id, size_t len) const { return {buffers_ + static_cast<size_t>(id) * buffer_size_, len}; }
+    // give a buffer back to the kernel after its data was consumed
+    void return_buffer(uint16_t id);
+    // buffers the kernel has left to pick, as far as the cqes seen so far tell: returned ones minus the ones
+    // reported used(IORING_CQE_F_BUFFER)
+    unsigned buffers_free() const { return buffers_free_; }
+
+    // false if the submission queue is full even after submitting
+    bool accept_multishot(int fd, uint64_t user_data);
+    bool recv_multishot(int fd, uint16_t group, uint64_t user_data);
+    bool poll_multishot(int fd, uint32_t events, uint64_t user_data);
+    bool poll(int fd, uint32_t events, uint64_t user_data);
+    // link: the next queued sqe starts only after this one completed
+    bool send(int fd, const void* buf, size_t len, uint64_t user_data, bool link = false);
+    bool shutdown(int fd, int how, uint64_t user_data);
+    bool cancel(uint64_t target, uint64_t user_data);
+    bool cancel_all(uint64_t user_data);
+
+    // submit queued sqes and wait for min_complete cqes(-1 timeout_ms waits forever)
+    // returns the number of sqes submitted or -1, a timeout is not an error
+    int submit_and_wait(unsigned min_complete = 1, int timeout_ms = -1);
+
+    // f(const io_uring_cqe&) for every ready cqe, returns how many
+    template <typename F>
+    unsigned for_each_cqe(F&& f) {
+        unsigned head = *cq_head_;
+        unsigned tail = std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire);
+        unsigned n = tail - head;
+        for (; head != tail; ++head) {
+            auto& cqe = cqes_[head & cq_mask_];
+            if (cqe.flags & IORING_CQE_F_BUFFER) {
+                --buffers_free_;
+            }
+            f(cqe);
+        }
+        std::atomic_ref<unsigned>(*cq_head_).store(head, std::memory_order_release);
+        return n;
+    }
+
+private:
+    io_uring_sqe* get_sqe_();
+    unsigned cq_ready_() const;
+
+    int fd_ = -1;
+    unsigned features_ = 0;
+
+    void* ring_ = nullptr;
+    size_t ring_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+    unsigned sq_local_tail_ = 0;  // queued, published to the kernel on submit
+
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+
+    io_uring_buf_ring* buf_ring_ = nullptr;
+    size_t buf_ring_size_ = 0;
+    char* buffers_ = nullptr;
+    unsigned buffer_count_ = 0;
+    unsigned buffer_size_ = 0;
+    uint16_t buf_tail_ = 0;
+    unsigned buffers_free_ = 0;
+};
+
+}  // namespace wheel
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace wheel {
+
+// move only void() callable(like std::move_only_function)
+// callables up to INLINE_SIZE bytes are stored inline, sizeof(Job) is one cache line
+class Job {
+public:
+    static constexpr size_t INLINE_SIZE = 48;
+
+    template <typename F>
+    static constexpr bool is_inline =
+        sizeof(F) <= INLINE_SIZE && alignof(F) <= alignof(std::max_align_t) && std::is_nothrow_move_constructible_v<F>;
+
+    Job() = default;
+    Job(std::nullptr_t) {}
+
+    template <typename F> requires (!std::is_same_v<std::decay_t<F>, Job>) && std::is_invocable_v<std::decay_t<F>&>
+    Job(F&& f) {
+        using T = std::decay_t<F>;
+        if constexpr (is_inline<T>) {
+            new (storage_) T(std::forward<F>(f));
+            ops_ = &inline_ops_<T>;
+        } else {
+            *reinterpret_cast<T**>(storage_) = new T(std::forward<F>(f));
+            ops_ = &heap_ops_<T>;
+        }
+    }
+
+    Job(Job&& other) noexcept { move_from_(other); }
+
+    Job& operator=(Job&& other) noexcept {
+        if (this != &other) {
+            reset();
+            move_from_(other);
+        }
+        return *this;
+    }
+
+    Job& operator=(std::nullptr_t) {
+        reset();
+        return *this;
+    }
+
+    Job(const Job&) = delete;
+    Job& operator=(const Job&) = delete;
+
+    ~Job() { reset(); }
+
+    explicit operator bool() const { return ops_ != nullptr; }
+
+    void operator()() { ops_->invoke(storage_); }
+
+    void reset() {
+        if (ops_) {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(void* self);
+        void (*move)(void* dst, void* src);  // move construct dst and destroy src
+        void (*destroy)(void* self);
+    };
+
+    template <typename T>
+    static constexpr Ops inline_ops_ {
+        [](void* self) { (*static_cast<T*>(self))(); },
+        [](void* dst, void* src) {
+            new (dst) T(std::move(*static_cast<T*>(src)));
+            static_cast<T*>(src)->~T();
+        },
+        [](void* self) { static_cast<T*>(self)->~T(); },
+    };
+
+    // storage_ holds a T*
+    template <typename T>
+    static constexpr Ops heap_ops_ {
+        [](void* self) { (**static_cast<T**>(self))(); },
+        [](void* dst, void* src) { *static_cast<T**>(dst) = *static_cast<T**>(src); },
+        [](void* self) { delete *static_cast<T**>(self); },
+    };
+
+    void move_from_(Job& other) {
+        if (other.ops_) {
+            other.ops_->move(storage_, other.storage_);
+            ops_ = other.ops_;
+            other.ops_ = nullptr;
+        }
+    }
+
+    alignas(std::max_align_t) unsigned char storage_[INLINE_SIZE];
+    const Ops* ops_ = nullptr;
+};
+
+}  // namespace wheel
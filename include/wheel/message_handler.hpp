@@ -1,25 +1,62 @@
 #pragma once
 
-#include <wheel/socket_handler.hpp>
 #include <wheel/ring_buffer.hpp>
+#include <wheel/socket_handler.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
 
 namespace wheel {
 
+// length header in front of every message
+enum class Framing : uint8_t {
+    DECIMAL,  // 4 ascii digits, messages up to 9999 bytes(the original format)
+    U32,  // 4 byte big endian
+    VARINT,  // LEB128, 1 byte for messages under 128 bytes
+};
+
 class MessageHandler : public SocketHandler {
 public:
-    MessageHandler() = default;
+    explicit MessageHandler(Framing framing = Framing::DECIMAL) : framing_(framing) {}
     virtual ~MessageHandler() = default;
 
+    // readv into the ring until EAGAIN, every complete message is handed over in place
     bool process() override;
+    bool reading() const override { return ring_.size() > 0 || !large_.empty(); }
 
+    // msg points into the receive buffer, only valid during the call
     virtual bool process(std::string_view msg) = 0;
-    static bool send(wheel::Socket& socket, std::string_view msg);
+    // the message as two views where the ring wraps(tail empty if it did not), valid during the call
+    // the default joins a wrapped message and calls process(msg), override to take the views without the copy
+    virtual bool process(std::span<const char> head, std::span<const char> tail);
+    // to this connection: framed into the output queue, sent with everything else after process()
+    void send(std::string_view msg);
+    // to any socket, blocks until the whole frame is written
+    static bool send(wheel::Socket& socket, std::string_view msg, Framing framing = Framing::DECIMAL);
+
+    // writes the header of a size byte message to out(MAX_HEADER bytes), returns its length or 0 if too large
+    static size_t encode_header(Framing framing, size_t size, char* out);
+    // header at the front of data: its length and the message size, 0 if incomplete, -1 if invalid
+    static int decode_header(Framing framing, std::string_view data, size_t& size);
+
+    static constexpr int SEND_TIMEOUT_MS = 1000;  // of the blocking send
+    static constexpr size_t MAX_HEADER = 5;
+    static constexpr size_t MAX_MESSAGE = 64 << 20;  // larger headers close the connection
+    static constexpr uint32_t RING_SIZE = 4096;  // receive ring, larger messages are assembled in a buffer of their own
 
 protected:
-    RingBuffer<char, 4096> ring_buffer_;
-    char buf_[1024];
+    Framing framing_;
+
+private:
+    bool drain_();
 
-    bool recv_();
+    RingBuffer<char, RING_SIZE> ring_;  // received, not yet processed
+    std::string large_;  // body of a message larger than the ring, recv'd into directly
+    size_t large_size_ = 0;  // received of it
+    std::string joined_;  // a wrapped message for process(msg)
 };
 
 }  // namespace wheel
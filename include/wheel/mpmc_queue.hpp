@@ -0,0 +1,179 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace wheel {
+
+// bounded lock free multi producer multi consumer queue(Dmitry Vyukov)
+// every cell has a sequence number telling whose turn it is:
+//   seq == pos      free, the producer claiming pos may write
+//   seq == pos + 1  full, the consumer claiming pos may read
+template <typename T>
+class MPMCQueue {
+public:
+    // capacity is rounded up to a power of 2
+    explicit MPMCQueue(size_t capacity = 8192) {
+        capacity_ = 2;
+        while (capacity_ < capacity) {
+            capacity_ <<= 1;
+        }
+        mask_ = capacity_ - 1;
+        cells_ = std::make_unique<Cell[]>(capacity_);
+        for (size_t i = 0; i < capacity_; ++i) {
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    ~MPMCQueue() {
+        size_t in = enqueue_pos_.load(std::memory_order_relaxed);
+        for (size_t pos = dequeue_pos_.load(std::memory_order_relaxed); pos != in; ++pos) {
+            cells_[pos & mask_].ptr()->~T();
+        }
+    }
+
+    MPMCQueue(const MPMCQueue&) = delete;
+    MPMCQueue& operator=(const MPMCQueue&) = delete;
+
+    size_t capacity() const { return capacity_; }
+
+    // approximate when used concurrently
+    size_t size() const {
+        size_t in = enqueue_pos_.load(std::memory_order_relaxed);
+        size_t out = dequeue_pos_.load(std::memory_order_relaxed);
+        return in > out ? in - out : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    bool try_push(const T& value) {
+        return emplace_(value);
+    }
+
+    // value is untouched when the queue is full
+    bool try_push(T&& value) {
+        return emplace_(std::move(value));
+    }
+
+    bool try_pop(T& value) {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {  // empty
+                return false;
+            } else {
+                pos = dequeue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(*cell->ptr());
+        cell->ptr()->~T();
+        cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    // claim up to n consecutive cells with one CAS, return the number pushed(from the front of [first, first + n))
+    template <typename It>
+    size_t push_bulk(It first, size_t n) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        size_t k;
+        while (true) {
+            k = ready_(pos, n, 0);
+            if (k == 0) {
+                return 0;
+            }
+            if (enqueue_pos_.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        for (size_t i = 0; i < k; ++i, ++first) {
+            Cell& cell = cells_[(pos + i) & mask_];
+            new (cell.ptr()) T(std::move(*first));
+            cell.seq.store(pos + i + 1, std::memory_order_release);
+        }
+        return k;
+    }
+
+    // pop up to n values into out, return the number popped
+    template <typename OutIt>
+    size_t pop_bulk(OutIt out, size_t n) {
+        size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        size_t k;
+        while (true) {
+            k = ready_(pos, n, 1);
+            if (k == 0) {
+                return 0;
+            }
+            if (dequeue_pos_.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed)) {
+                break;
+            }
+        }
+        for (size_t i = 0; i < k; ++i, ++out) {
+            Cell& cell = cells_[(pos + i) & mask_];
+            *out = std::move(*cell.ptr());
+            cell.ptr()->~T();
+            cell.seq.store(pos + i + mask_ + 1, std::memory_order_release);
+        }
+        return k;
+    }
+
+private:
+    struct Cell {
+        std::atomic<size_t> seq;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T* ptr() { return std::launder(reinterpret_cast<T*>(storage)); }
+    };
+
+    template <typename U>
+    bool emplace_(U&& value) {
+        size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells_[pos & mask_];
+            size_t seq = cell->seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {  // full
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+        new (cell->ptr()) T(std::forward<U>(value));
+        cell->seq.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // number of consecutive cells from pos(at most n) whose seq is pos + i + offset
+    // once ready a cell stays ready until its position is claimed, so the whole run can be claimed at once
+    size_t ready_(size_t pos, size_t n, size_t offset) const {
+        n = std::min(n, capacity_);
+        size_t k = 0;
+        while (k < n && cells_[(pos + k) & mask_].seq.load(std::memory_order_acquire) == pos + k + offset) {
+            ++k;
+        }
+        return k;
+    }
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t capacity_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> enqueue_pos_ = 0;  // separate cache lines for producers and consumers
+    alignas(64) std::atomic<size_t> dequeue_pos_ = 0;
+};
+
+}  // namespace wheel
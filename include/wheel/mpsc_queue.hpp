@@ -0,0 +1,66 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace wheel {
+
+// unbounded lock free multi producer single consumer queue, the consumer takes everything at once:
+// producers push onto an intrusive stack(one CAS), drain() swaps the whole stack out and runs it oldest first
+template <typename T>
+class MPSCQueue {
+public:
+    MPSCQueue() = default;
+    ~MPSCQueue() {
+        drain([](T&) {});
+    }
+
+    MPSCQueue(const MPSCQueue&) = delete;
+    MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+    // any thread, true if the queue was empty: the consumer may be waiting for it
+    bool push(T value) {
+        auto* node = new Node{std::move(value), nullptr};
+        Node* head = head_.load(std::memory_order_relaxed);
+        do {
+            node->next = head;
+        } while (!head_.compare_exchange_weak(head, node, std::memory_order_seq_cst, std::memory_order_relaxed));
+        return head == nullptr;
+    }
+
+    // approximate when used concurrently
+    bool empty() const { return head_.load(std::memory_order_seq_cst) == nullptr; }
+
+    // consumer only: f(T&) for everything pushed so far in push order(per producer), returns how many
+    template <typename F>
+    size_t drain(F&& f) {
+        Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+        Node* fifo = nullptr;
+        while (node) {
+            Node* next = node->next;
+            node->next = fifo;
+            fifo = node;
+            node = next;
+        }
+        size_t count = 0;
+        while (fifo) {
+            Node* next = fifo->next;
+            f(fifo->value);
+            delete fifo;
+            fifo = next;
+            ++count;
+        }
+        return count;
+    }
+
+private:
+    struct Node {
+        T value;
+        Node* next;
+    };
+
+    std::atomic<Node*> head_ = nullptr;
+};
+
+}  // namespace wheel
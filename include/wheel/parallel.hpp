@@ -0,0 +1,222 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace wheel {
+
+// how [first, last) is cut into chunks
+enum class Partition : uint8_t {
+    STATIC,  // one equal chunk per thread, or fixed chunks of grain
+    GUIDED,  // chunks of remaining / (2 * threads) taken on demand, at least grain
+    ADAPTIVE,  // on demand, every thread doubles or halves its chunk to run about ADAPTIVE_CHUNK_TIME
+};
+
+inline constexpr std::chrono::nanoseconds ADAPTIVE_CHUNK_TIME = std::chrono::microseconds(50);
+
+namespace detail {
+
+// run body(begin, end) over [first, last) on pool workers and the calling thread
+// the calling thread runs queued tasks while waiting, so nested calls from workers never block the pool
+template <typename Pool, typename Body>
+void fork_join(Pool& pool, int64_t first, int64_t last, Body& body, Partition partition, int64_t grain) {
+    int64_t n = last - first;
+    if (n <= 0) {
+        return;
+    }
+    int64_t threads = pool.size() + 1;
+    grain = std::max<int64_t>(grain, 1);
+
+    std::atomic<int> pending = 0;
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto run = [&](auto&& fn) {
+        try {
+            fn();
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    };
+    auto spawn = [&](auto fn) {
+        pending.fetch_add(1, std::memory_order_relaxed);
+        pool.post([&run, &pending, fn] {
+            run(fn);
+            pending.fetch_sub(1, std::memory_order_release);  // the last access to this frame
+        });
+    };
+
+    std::atomic<int64_t> cursor = first;
+    auto guided = [&, threads, last, grain] {
+        int64_t begin = cursor.load(std::memory_order_relaxed);
+        while (begin < last) {
+            int64_t size = std::max(grain, (last - begin) / (2 * threads));
+            if (cursor.compare_exchange_weak(begin, begin + size, std::memory_order_relaxed)) {
+                body(begin, std::min(begin + size, last));
+                begin = cursor.load(std::memory_order_relaxed);
+            }
+        }
+    };
+    auto adaptive = [&, threads, last, grain] {
+        int64_t size = grain;
+        while (true) {
+            int64_t begin = cursor.fetch_add(size, std::memory_order_relaxed);
+            if (begin >= last) {
+                return;
+            }
+            auto start = std::chrono::steady_clock::now();
+            body(begin, std::min(begin + size, last));
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            if (elapsed < ADAPTIVE_CHUNK_TIME / 2) {
+                size *= 2;
+            } else if (elapsed > ADAPTIVE_CHUNK_TIME * 2) {
+                size = std::max(grain, size / 2);
+            }
+            // never take more than a fair share of what is left
+            size = std::min(size, std::max(grain, (last - begin) / threads));
+        }
+    };
+
+    switch (partition) {
+        case Partition::STATIC: {
+            int64_t size = grain > 1 ? grain : (n + threads - 1) / threads;
+            for (int64_t begin = first + size; begin < last; begin += size) {
+                int64_t end = std::min(begin + size, last);
+                spawn([&body, begin, end] { body(begin, end); });
+            }
+            run([&] { body(first, std::min(first + size, last)); });
+            break;
+        }
+        case Partition::GUIDED:
+            for (int64_t i = 1; i < std::min(threads, n); ++i) {
+                spawn([&guided] { guided(); });
+            }
+            run(guided);
+            break;
+        case Partition::ADAPTIVE:
+            for (int64_t i = 1; i < std::min(threads, n); ++i) {
+                spawn([&adaptive] { adaptive(); });
+            }
+            run(adaptive);
+            break;
+    }
+
+    // help instead of blocking
+    while (pending.load(std::memory_order_acquire) > 0) {
+        if (!pool.run_pending_task()) {
+            std::this_thread::yield();
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+// integers are indexes, anything else is a random access iterator
+template <typename It>
+int64_t distance(It first, It last) {
+    if constexpr (std::is_integral_v<It>) {
+        return static_cast<int64_t>(last) - static_cast<int64_t>(first);
+    } else {
+        return std::distance(first, last);
+    }
+}
+
+template <typename It>
+decltype(auto) at(It first, int64_t i) {
+    if constexpr (std::is_integral_v<It>) {
+        return static_cast<It>(first + i);
+    } else {
+        return first[i];
+    }
+}
+
+}  // namespace detail
+
+// f(i) for every index i in [first, last), or f(*it) for every iterator
+template <typename Pool, typename It, typename F>
+void parallel_for(Pool& pool, It first, It last, F&& f, Partition partition = Partition::ADAPTIVE, int64_t grain = 1) {
+    auto body = [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+            f(detail::at(first, i));
+        }
+    };
+    detail::fork_join(pool, 0, detail::distance(first, last), body, partition, grain);
+}
+
+// *(d_first + i) = op(*(first + i))
+template <typename Pool, typename InputIt, typename OutputIt, typename F>
+OutputIt parallel_transform(Pool& pool, InputIt first, InputIt last, OutputIt d_first, F&& op,
+                            Partition partition = Partition::ADAPTIVE, int64_t grain = 1) {
+    auto body = [&](int64_t begin, int64_t end) {
+        for (int64_t i = begin; i < end; ++i) {
+            d_first[i] = op(first[i]);
+        }
+    };
+    int64_t n = std::distance(first, last);
+    detail::fork_join(pool, 0, n, body, partition, grain);
+    return d_first + n;
+}
+
+// like std::transform_reduce, reduce must be associative and commutative
+// every worker folds its chunks into its own partial result, they are combined with init at the end
+template <typename Pool, typename It, typename T, typename Reduce, typename Transform>
+T parallel_reduce(Pool& pool, It first, It last, T init, Reduce&& reduce, Transform&& transform,
+                  Partition partition = Partition::ADAPTIVE, int64_t grain = 1) {
+    struct alignas(64) Partial {
+        std::optional<T> value;
+    };
+    int workers = pool.size();
+    std::vector<Partial> partials(workers + 1);  // the last one is shared by threads outside the pool
+    std::mutex shared_mutex;
+
+    auto merge = [&](Partial& partial, T&& value) {
+        if (partial.value) {
+            partial.value = reduce(std::move(*partial.value), std::move(value));
+        } else {
+            partial.value.emplace(std::move(value));
+        }
+    };
+    auto body = [&](int64_t begin, int64_t end) {
+        T acc = transform(detail::at(first, begin));
+        for (int64_t i = begin + 1; i < end; ++i) {
+            acc = reduce(std::move(acc), transform(detail::at(first, i)));
+        }
+        int index = pool.current_worker_index();
+        if (index >= 0 && index < workers) {
+            merge(partials[index], std::move(acc));
+        } else {
+            std::lock_guard<std::mutex> lock(shared_mutex);
+            merge(partials.back(), std::move(acc));
+        }
+    };
+    detail::fork_join(pool, 0, detail::distance(first, last), body, partition, grain);
+
+    for (auto& partial : partials) {
+        if (partial.value) {
+            init = reduce(std::move(init), std::move(*partial.value));
+        }
+    }
+    return init;
+}
+
+// std::reduce with plus
+template <typename Pool, typename It, typename T>
+T parallel_reduce(Pool& pool, It first, It last, T init, Partition partition = Partition::ADAPTIVE, int64_t grain = 1) {
+    return parallel_reduce(pool, first, last, std::move(init), std::plus<>{},
+                           [](const auto& value) -> T { return value; }, partition, grain);
+}
+
+}  // namespace wheel
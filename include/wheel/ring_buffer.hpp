@@ -1,6 +1,7 @@
 // TODO: thread safety
 #pragma once
 
+#include <array>
 #include <span>
 #include <cstring>
 #include <cstdint>
@@ -12,7 +13,7 @@ class RingBuffer {
     static_assert((N & (N - 1)) == 0, "N must be a power of 2");
 
 public:
-    uint32_t size() {
+    uint32_t size() const {
         return in_ - out_;
     }
 
@@ -42,9 +43,32 @@ public:
     uint32_t pop(uint32_t size) {
         size = std::min(size, this->size());
         out_ += size;
+        if (in_ == out_) {  // start over at the front, fewer wraps
+            in_ = out_ = 0;
+        }
         return size;
     }
 
+    // without copies: fill the free space(two spans where it wraps) then commit what was written
+    std::array<std::span<T>, 2> write_spans() {
+        auto space = N - size();
+        auto first_size = std::min(space, N - (in_ & (N - 1)));
+        return {std::span<T>(buf_ + (in_ & (N - 1)), first_size), std::span<T>(buf_, space - first_size)};
+    }
+
+    void commit(uint32_t size) {
+        in_ += std::min(size, N - this->size());
+    }
+
+    // the first size elements in place, valid until they are popped
+    std::array<std::span<const T>, 2> read_spans(uint32_t size) const {
+        size = std::min(size, this->size());
+        auto first_size = std::min(size, N - (out_ & (N - 1)));
+        return {std::span<const T>(buf_ + (out_ & (N - 1)), first_size), std::span<const T>(buf_, size - first_size)};
+    }
+
+    static constexpr uint32_t capacity() { return N; }
+
 private:
     T buf_[N];
     uint32_t in_ = 0;
@@ -8,12 +8,12 @@ namespace wheel {
 template <typename T>
 class SafeQueue {
 public:
-    size_t size() {
+    size_t size() const {
         std::unique_lock<std::mutex> lock(mutex_);
         return queue_.size();
     }
 
-    bool empty() {
+    bool empty() const {
         std::unique_lock<std::mutex> lock(mutex_);
         return queue_.empty();
     }
@@ -23,6 +23,28 @@ public:
         queue_.push(value);
     }
 
+    void push(T&& value) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        queue_.push(std::move(value));
+    }
+
+    // unbounded, same interface as MPMCQueue
+    bool try_push(T&& value) {
+        push(std::move(value));
+        return true;
+    }
+
+    // front() and pop() in one lock
+    bool try_pop(T& value) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (queue_.empty()) {
+            return false;
+        }
+        value = std::move(queue_.front());
+        queue_.pop();
+        return true;
+    }
+
     void pop() {
         std::unique_lock<std::mutex> lock(mutex_);
         queue_.pop();
@@ -35,7 +57,7 @@ public:
 
 private:
     std::queue<T> queue_;
-    std::mutex mutex_;
+    mutable std::mutex mutex_;
 };
 
 }  // namespace wheel
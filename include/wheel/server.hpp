@@ -1,14 +1,31 @@
 #pragma once
 
+#include <wheel/affinity.hpp>
+#include <wheel/connection_pool.hpp>
+#include <wheel/connection_table.hpp>
+#include <wheel/datagram_handler.hpp>
 #include <wheel/epoll.hpp>
+#include <wheel/io_uring.hpp>
 #include <wheel/log.hpp>
+#include <wheel/mpsc_queue.hpp>
 #include <wheel/socket.hpp>
 #include <wheel/thread_pool.hpp>
+#include <wheel/timing_wheel.hpp>
 #include <wheel/socket_handler.hpp>
+#include <wheel/stream_handler.hpp>
 
+#include <fcntl.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
 #include <memory>
+#include <string>
+#include <thread>
 #include <unordered_map>
+#include <vector>
 #include <cstring>
 
 namespace wheel {
@@ -16,16 +33,183 @@ namespace wheel {
 template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
 class Server;
 
+enum class ServerMode : uint8_t {
+    THREAD_POOL,  // one epoll loop, handlers run on the thread pool and re-arm their socket(EPOLLONESHOT)
+    MULTI_REACTOR,  // one epoll loop and listening socket(SO_REUSEPORT) per thread, handlers run inline
+    // like MULTI_REACTOR with an io_uring per thread: multishot accept, multishot recv into provided buffers
+    // for StreamHandler(multishot poll + process() for other handlers), falls back to MULTI_REACTOR
+    IO_URING,
+};
+
+struct ServerOptions {
+    ServerMode mode = ServerMode::THREAD_POOL;
+    // THREAD_POOL: pin the reactor thread and its handler workers to the cpus of one NUMA node
+    // MULTI_REACTOR / IO_URING: pin every reactor to its own cpu, spread over the nodes(or packed on node)
+    bool colocate = false;
+    int node = -1;  // -1 means the node the reactor thread is running on, or every node for the per thread modes
+    size_t connections = 256;  // per reactor, slots and handler objects allocated up front, grows past it
+    int backlog = SOMAXCONN;
+    int accept_batch = 64;  // accepted per wakeup before the other sockets get a turn, 0 drains until EAGAIN
+    // MULTI_REACTOR / IO_URING: false shares one listening socket that the reactors wait on with EPOLLEXCLUSIVE,
+    // new connections go to an idle reactor instead of by the SO_REUSEPORT hash
+    bool reuse_port = true;
+    // idle connections are closed, 0 disables: read while waiting for a request(or the rest of one, see
+    // SocketHandler::reading), write while output is queued, keepalive between requests
+    // THREAD_POOL times from when an event is handed to the pool
+    std::chrono::milliseconds read_timeout{0};
+    std::chrono::milliseconds write_timeout{0};
+    std::chrono::milliseconds keepalive_timeout{0};
+    // backpressure: a connection is not read while its queued output or unprocessed input(SocketHandler::pending_input)
+    // is above high, until it is back at low, the handler hears of it through on_throttle / on_unthrottle
+    // THREAD_POOL ignores the input watermarks, only the writable event can resume a connection there
+    Watermarks input_watermarks{};
+    Watermarks output_watermarks{.high = 4 << 20, .low = 1 << 20};
+    // local ipc: listen on this AF_UNIX path instead of the port("@name" is in the abstract namespace), a stale
+    // socket file of an earlier run is removed first; the reactors share the one socket(no SO_REUSEPORT for it)
+    std::string unix_path{};
+    // or SOCK_SEQPACKET: a recv gets one message of the peer, StreamHandler::on_recv sees it whole if it fits
+    // the 4096 byte receive buffer(the rest of a longer one is dropped by the kernel)
+    int unix_type = SOCK_STREAM;
+    // set on the listening socket(s) before bind, accepted connections inherit nodelay, cork, the buffer sizes and
+    // busy_poll from it without a syscall each; defer_accept, fastopen and incoming_cpu only act there
+    // colocate without incoming_cpu: every reactor's SO_REUSEPORT socket gets the cpu the reactor is pinned to
+    SocketOptions listen_socket{};
+    // set on every accepted connection, a syscall per option: for what is not inherited or differs from the listener
+    // quickack is cleared by the kernel once it thinks the connection is interactive, true sets it again after
+    // every read(a syscall each): a request written in parts by a Nagle client is acked before the client waits
+    SocketOptions accepted_socket{};
+    // outbound connections of the handlers, a pool per reactor(ConnectionPool::local() in process()), its events
+    // are handled by the reactor like the accepted ones; MULTI_REACTOR / IO_URING, THREAD_POOL handlers run
+    // on the workers where it is not available
+    PoolOptions upstream{};
+};
+
+// IO_URING state of an accepted socket
+struct RingConnection {
+    SocketHandler* handler = nullptr;  // null if the slot is free
+    std::string reply;  // from StreamHandler::on_recv, waiting for the send in flight
+    std::string sending;  // owned by the send in flight
+    size_t sent = 0;
+    int ops = 0;  // sqes without their last cqe yet, the fd is closed only at 0
+    uint64_t armed = 0;  // user data of the multishot recv / poll, 0 if none
+    std::vector<std::pair<uint16_t, unsigned>> held;  // provided buffers received while throttled, {id, length}
+    bool closing = false;
+};
+
+// work for a reactor from another thread, run by the reactor after its events
+struct ReactorTask {
+    enum Op : uint8_t {
+        REARM,  // THREAD_POOL: a worker is done with handler, epoll_ctl it with events
+        CLOSE_HANDLER,  // THREAD_POOL: process() of handler failed
+        SEND,  // Server::send, to the connection {fd, id}
+        CLOSE,  // Server::close
+    };
+    Op op = REARM;
+    int fd = -1;
+    SocketHandler* handler = nullptr;
+    uint32_t events = 0;
+    uint64_t id = 0;
+    std::string data{};
+};
+
+// one event loop with the sockets it owns, only its own thread touches them
+// (THREAD_POOL: handlers run on the pool, but accept, epoll_ctl and erase stay on the reactor thread)
+struct Reactor {
+    static constexpr int MAX_EVENTS = 128;
+    static constexpr unsigned RING_ENTRIES = 256;
+    static constexpr unsigned RING_BUFFERS = 256;  // provided recv buffers
+    static constexpr unsigned RING_BUFFER_SIZE = 4096;
+    static constexpr int TIMER_TICK_MS = 50;  // timeout resolution
+    static constexpr size_t TIMER_SLOTS = 1024;
+
+    Reactor(size_t handler_size, size_t handler_align, size_t capacity, const PoolOptions& upstream = {})
+        : upstreams(epoll, upstream), connections(handler_size, handler_align, capacity) {
+        wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (wake_fd != -1 && !epoll.add(wake_fd, EPOLLIN, &inbox)) {
+            ::close(wake_fd);
+            wake_fd = -1;
+        }
+        spare_fd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+    }
+    ~Reactor() {
+        if (wake_fd != -1) {
+            ::close(wake_fd);
+        }
+        if (spare_fd != -1) {
+            ::close(spare_fd);
+        }
+    }
+
+    // any thread, the eventfd is written only if the reactor sleeps and nothing was queued before
+    // (the reactor sets sleeping before it looks at the inbox a last time, the producer after its push)
+    void post(ReactorTask&& task) {
+        if (inbox.push(std::move(task)) && sleeping.load()) {
+            wake();
+        }
+    }
+    void wake() {
+        uint64_t one = 1;
+        [[maybe_unused]] auto n = ::write(wake_fd, &one, sizeof one);
+    }
+    // the reactor thread, after epoll reported the eventfd
+    void woken() {
+        uint64_t count;
+        [[maybe_unused]] auto n = ::read(wake_fd, &count, sizeof count);
+    }
+    // EMFILE / ENFILE: the pending connection keeps the listener readable, a loop that only retries spins
+    // the spare fd makes room to accept and close it(the peer sees the close), false if there is no spare
+    bool shed_connection(int listen_fd) {
+        if (spare_fd == -1) {
+            return false;
+        }
+        ::close(spare_fd);
+        int fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd != -1) {
+            ::close(fd);
+        }
+        spare_fd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+        return fd != -1;
+    }
+    // for ConnectionRef, the reactor index in the top 16 bits, never 0
+    uint64_t new_id() { return static_cast<uint64_t>(index) << 48 | ++last_id; }
+
+    int index = 0;
+    Epoll epoll{MAX_EVENTS};
+    MPSCQueue<ReactorTask> inbox;
+    int wake_fd = -1;  // eventfd in epoll, &inbox as its pointer
+    int spare_fd = -1;  // /dev/null, see shed_connection
+    std::atomic<bool> sleeping = false;  // in epoll_wait / io_uring_enter, or about to be
+    uint64_t last_id = 0;
+    // THREAD_POOL: sends and closes for a connection a worker runs, by fd, done when the worker hands it back
+    std::unordered_map<int, std::vector<ReactorTask>> parked;
+    ConnectionPool upstreams;  // registered in epoll, only the reactor thread
+    std::unique_ptr<SocketHandler> listener;
+    ConnectionTable connections;
+    TimingWheel timers{std::chrono::milliseconds(TIMER_TICK_MS), TIMER_SLOTS};  // by fd, only the reactor thread
+    // fds of throttled connections, checked every loop: input drains without an event on the socket
+    std::vector<int> throttled;
+
+    // IO_URING
+    std::vector<RingConnection> ring_connections;  // by fd
+    // fds whose multishot recv ended with no provided buffer left, armed again once one is returned
+    std::vector<int> starved;
+    int listen_fd = -1;
+    int ring_ops = 0;  // like RingConnection::ops, for the whole ring
+    std::unique_ptr<IoUring> ring;
+};
+
 template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
 class ListenHandler : public SocketHandler {
 public:
-    ListenHandler(Socket&& socket, Server<HandlerType>& server) : SocketHandler(std::move(socket)), server_(server) {}
+    ListenHandler(Socket&& socket, Server<HandlerType>& server, Reactor& reactor)
+        : SocketHandler(std::move(socket)), server_(server), reactor_(reactor) {}
     ~ListenHandler() = default;
 
-    virtual bool process() override; 
+    virtual bool process() override;
 
 private:
     Server<HandlerType>& server_;
+    Reactor& reactor_;
 };
 
 template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
@@ -33,119 +217,1114 @@ class Server {
     friend class ListenHandler<HandlerType>;
 
 public:
-    Server() = default;
+    explicit Server(ServerOptions options = {}) : options_(std::move(options)) {}
     ~Server() = default;
 
+    // blocks until stop(), num_threads is the number of pool workers or reactors
     void start(unsigned short port, int num_threads);
+    // any thread, wakes every loop, start() returns once they are done
+    void stop();
+    // any thread: data goes out on the reactor of the connection(THREAD_POOL: after process() returned if a worker
+    // runs the handler), dropped if the connection is gone by then; false if ref names no connection
+    bool send(ConnectionRef ref, std::string data);
+    // any thread: the reactor sends what the socket takes of the queued output and closes the connection
+    bool close(ConnectionRef ref);
+
+    // throttled connections are checked at least this often, and the io_uring shutdown waits this long per round
+    static constexpr int POLL_MS = 100;
 
 private:
-    bool init_listen_(unsigned short port);
-    void del_socket_(Socket& socket);
+    bool init_listen_(Reactor& reactor, unsigned short port, int shared_fd);
+    bool listen_unix_(Socket& socket);
+    // the reactors wait on one listening socket
+    bool shared_listener_() const {
+        return options_.mode != ServerMode::THREAD_POOL && (!options_.reuse_port || !options_.unix_path.empty());
+    }
+    bool init_datagram_(Reactor& reactor, unsigned short port);
+    void run_(Reactor& reactor);
+    static bool handle_(SocketHandler* handler, uint32_t events, bool quickack);
+    void set_watermarks_(SocketHandler* handler) const;
+    void update_events_(Reactor& reactor, SocketHandler* handler);
+    void update_listener_events_(Reactor& reactor);
+    void close_listener_(Reactor& reactor);
+    void check_throttled_(Reactor& reactor);
+    void run_ring_(Reactor& reactor);
+    void colocate_();
+    void place_reactor_(int index);
+    void del_socket_(Reactor& reactor, Socket& socket);
+    static uint32_t oneshot_events_(SocketHandler* handler);
 
-    Epoll epoll_;
-    bool stop_ = false;
-    ThreadPool thread_pool_;
-    std::unordered_map<int, std::unique_ptr<SocketHandler>> handlers_map_;  // {fd, handler}
+    // the inbox
+    bool post_(ConnectionRef ref, ReactorTask&& task);
+    void run_inbox_(Reactor& reactor);
+    void run_task_(Reactor& reactor, ReactorTask& task);
+    bool deliver_(Reactor& reactor, SocketHandler* handler, ReactorTask& task);
+
+    // idle timeouts
+    std::chrono::milliseconds timeout_(SocketHandler* handler, bool sending) const;
+    void touch_(Reactor& reactor, int fd, std::chrono::milliseconds timeout, TimingWheel::Clock::time_point now);
+    void expire_(Reactor& reactor, TimingWheel::Clock::time_point now);
+    int wait_ms_(const Reactor& reactor) const;
+
+    // IO_URING, user data is {op, fd}
+    enum RingOp : uint64_t {
+        RING_ACCEPT = 1, RING_RECV, RING_POLL, RING_WRITABLE, RING_SEND, RING_SHUTDOWN, RING_CANCEL, RING_EPOLL
+    };
+    static uint64_t ring_tag_(RingOp op, int fd) { return op << 32 | static_cast<uint32_t>(fd); }
+    void on_cqe_(Reactor& reactor, const io_uring_cqe& cqe);
+    void ring_accept_(Reactor& reactor, int fd);
+    void ring_arm_(Reactor& reactor, int fd, RingConnection& conn);
+    void ring_flush_(Reactor& reactor, int fd, RingConnection& conn);
+    void ring_writable_(Reactor& reactor, int fd, RingConnection& conn);
+    void ring_feed_starved_(Reactor& reactor);
+    void ring_task_(Reactor& reactor, ReactorTask& task);
+    void ring_close_(Reactor& reactor, int fd, RingConnection& conn);
+    void ring_throttle_(Reactor& reactor, int fd, RingConnection& conn);
+    void ring_recv_(Reactor& reactor, int fd, RingConnection& conn, uint16_t id, unsigned len);
+
+    ServerOptions options_;
+    std::atomic<bool> stop_ = false;
+    std::atomic<bool> started_ = false;  // reactors_ is complete, stop() / send() may use it
+    bool timeouts_ = false;  // any of them set
+    bool quickack_ = false;  // accepted_socket.quickack, set again after every read
+    std::vector<std::unique_ptr<Reactor>> reactors_;
+    ThreadPool thread_pool_;  // destroyed first, its tasks use the handlers
 };
 
 template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
 void Server<HandlerType>::start(unsigned short port, int num_threads) {
-    if (init_listen_(port)) {
+    if constexpr (std::is_base_of_v<DatagramHandler, HandlerType>) {
+        if (options_.mode == ServerMode::IO_URING) {
+            options_.mode = ServerMode::MULTI_REACTOR;  // recvmmsg batches already, nothing to gain
+        }
+    }
+    if (options_.mode == ServerMode::IO_URING && !IoUring::supported()) {
+        Log::info("server: io_uring lacks multishot accept / recv or provided buffers, use epoll");
+        options_.mode = ServerMode::MULTI_REACTOR;
+    }
+    bool multi = options_.mode != ServerMode::THREAD_POOL;
+    timeouts_ = options_.read_timeout.count() > 0 || options_.write_timeout.count() > 0
+        || options_.keepalive_timeout.count() > 0;
+    quickack_ = options_.accepted_socket.quickack.value_or(false);
+    int num_reactors = multi ? std::max(num_threads, 1) : 1;
+    for (int i = 0; i < num_reactors; ++i) {
+        auto& reactor = reactors_.emplace_back(
+            std::make_unique<Reactor>(sizeof(HandlerType), alignof(HandlerType), options_.connections, options_.upstream));
+        reactor->index = i;
+        if (reactor->wake_fd == -1) {
+            Log::error("server eventfd error: {}(errno: {})", std::strerror(errno), errno);
+            return;
+        }
+        int shared_fd = shared_listener_() && i > 0 ? reactors_[0]->listener->socket().fd() : -1;
+        if (!init_listen_(*reactor, port, shared_fd)) {
+            Log::error("server init listen error");
+            return;
+        }
+    }
+    if (options_.unix_path.empty()) {
         Log::info("server start on port {}", port);
     } else {
-        Log::error("server init listen error");
+        Log::info("server start on {}", options_.unix_path);
+    }
+    started_.store(true);
+
+    if (!multi) {
+        if (options_.colocate) {
+            colocate_();
+        }
+        thread_pool_.add_thread(num_threads);
+        run_(*reactors_[0]);
         return;
     }
-    thread_pool_.add_thread(num_threads);
 
-    while (!stop_) {
-        int n = epoll_.wait();
-        for (int i = 0; i < n; ++i) {
-            int fd = epoll_.get_fd(i);
+    // the calling thread runs the first reactor
+    std::vector<std::thread> threads;
+    for (int i = 1; i < num_reactors; ++i) {
+        threads.emplace_back([this, i] {
+            place_reactor_(i);
+            options_.mode == ServerMode::IO_URING ? run_ring_(*reactors_[i]) : run_(*reactors_[i]);
+        });
+    }
+    place_reactor_(0);
+    options_.mode == ServerMode::IO_URING ? run_ring_(*reactors_[0]) : run_(*reactors_[0]);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
 
-            SocketHandler* handler = static_cast<SocketHandler*>(epoll_.get_ptr(i));
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+void Server<HandlerType>::run_(Reactor& reactor) {
+    auto& epoll = reactor.epoll;
+    if (options_.mode == ServerMode::MULTI_REACTOR) {
+        ConnectionPool::set_local(&reactor.upstreams);
+    }
+    while (!stop_.load()) {
+        reactor.sleeping.store(true);
+        int n = epoll.wait(reactor.inbox.empty() ? wait_ms_(reactor) : 0);
+        reactor.sleeping.store(false, std::memory_order_relaxed);
+        auto now = timeouts_ ? TimingWheel::Clock::now() : TimingWheel::Clock::time_point{};
+        for (int i = 0; i < n; ++i) {
+            void* ptr = epoll.get_ptr(i);
+            if (ptr == &reactor.inbox) {
+                reactor.woken();
+                continue;
+            }
+            SocketHandler* handler = static_cast<SocketHandler*>(ptr);
+            uint32_t events = epoll.get_events(i);
+            if (handler->upstream()) {
+                reactor.upstreams.handle(static_cast<UpstreamHandler*>(handler), events);
+                continue;
+            }
             auto& socket = handler->socket();
-            uint32_t events = epoll_.get_events(i);
             if (events & EPOLLHUP) {
                 Log::info("socket closed by peer");
-                del_socket_(socket);
-            } else if (events & EPOLLIN) {
-                thread_pool_.submit([this, handler]() {
-                    if (handler->process()) {
-                        epoll_.mod(handler->socket(), EPOLLIN | EPOLLET | EPOLLONESHOT | EPOLLERR, handler);
+                del_socket_(reactor, socket);
+            } else if (events & (EPOLLIN | EPOLLOUT | EPOLLERR)) {
+                // accept inline in every mode, the table is only changed on this thread
+                bool listener = handler == reactor.listener.get();
+                if (options_.mode == ServerMode::MULTI_REACTOR || listener) {
+                    // run to completion, level triggered so only EPOLLOUT changes
+                    if (!handle_(handler, events, quickack_ && !listener)) {
+                        if (listener) {
+                            close_listener_(reactor);
+                        } else {
+                            del_socket_(reactor, socket);
+                        }
+                        continue;
+                    }
+                    if (listener) {
+                        update_listener_events_(reactor);
+                    } else {
+                        update_events_(reactor, handler);
+                        touch_(reactor, socket.fd(), timeout_(handler, false), now);
+                    }
+                    continue;
+                }
+                // not running yet(EPOLLONESHOT), safe to look at
+                touch_(reactor, socket.fd(), timeout_(handler, false), now);
+                handler->set_dispatched(true);
+                thread_pool_.post({.priority = Priority::LATENCY}, [&reactor, handler, events, quickack = quickack_]() {
+                    // the reactor re-arms(or closes) it with the next batch of its inbox
+                    int fd = handler->socket().fd();
+                    if (handle_(handler, events, quickack)) {
+                        reactor.post({.op = ReactorTask::REARM, .fd = fd, .handler = handler,
+                                      .events = oneshot_events_(handler)});
                     } else {
-                        epoll_.mod(handler->socket(), EPOLLHUP, handler);
+                        reactor.post({.op = ReactorTask::CLOSE_HANDLER, .fd = fd, .handler = handler});
                     }
                 });
-            } else if (events & EPOLLOUT) {
-
             } else {
                 Log::error("unknown event");
-                del_socket_(socket);
+                del_socket_(reactor, socket);
+            }
+        }
+        if (!reactor.inbox.empty()) {
+            run_inbox_(reactor);
+        }
+        if (!reactor.throttled.empty()) {
+            check_throttled_(reactor);
+        }
+        if (timeouts_) {
+            expire_(reactor, now);
+        }
+        if (!reactor.upstreams.empty()) {
+            reactor.upstreams.expire(ConnectionPool::Clock::now());
+        }
+    }
+}
+
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+void Server<HandlerType>::set_watermarks_(SocketHandler* handler) const {
+    bool input = options_.mode != ServerMode::THREAD_POOL;
+    handler->set_watermarks(input ? options_.input_watermarks : Watermarks{}, options_.output_watermarks);
+}
+
+// MULTI_REACTOR: EPOLLIN unless throttled or closing, EPOLLOUT while output is queued, epoll_ctl only when that changes
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+void Server<HandlerType>::update_events_(Reactor& reactor, SocketHandler* handler) {
+    handler->update_throttle();
+    bool read = !handler->throttled() && !handler->closing();
+    bool write = handler->pending_output() > 0;
+    if (read == handler->read_armed() && write == handler->write_armed()) {
+        return;
+    }
+    if (handler->throttled() && handler->read_armed()) {
+        reactor.throttled.push_back(handler->socket().fd());
+    }
+    handler->set_read_armed(read);
+    handler->set_write_armed(write);
+    uint32_t events = (read ? uint32_t(EPOLLIN) : 0u) | (write ? uint32_t(EPOLLOUT) : 0u);
+    reactor.epoll.mod(handler->socket(), events, handler);
+}
+
+// a DatagramHandler: EPOLLOUT while sendmmsg left datagrams queued, its on_writable sends them
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+void Server<HandlerType>::update_listener_events_(Reactor& reactor) {
+    if constexpr (std::is_base_of_v<DatagramHandler, HandlerType>) {
+        auto* handler = static_cast<HandlerType*>(reactor.listener.get());
+        bool write = handler->pending_datagrams() > 0;
+        if (write != handler->write_armed()) {
+            handler->set_write_armed(write);
+            reactor.epoll.mod(handler->socket(), write ? uint32_t(EPOLLIN | EPOLLOUT) : uint32_t(EPOLLIN), handler);
+        }
+    }
+}
+
+// the listener gave up(a DatagramHandler's on_datagram returned false, ...): closed, the connections stay
+// every reactor has a socket of its own, a shared one is dup'ed
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+void Server<HandlerType>::close_listener_(Reactor& reactor) {
+    Log::error("server: listener stopped, socket closed");
+    if (!reactor.epoll.del(reactor.listener->socket())) {
+        Log::error("epoll del fd error: {}(errno: {})", std::strerror(errno), errno);
+    }
+    reactor.listener.reset();
+}
+
+// THREAD_POOL: throttled means output above low, so EPOLLOUT is armed to resume it
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+uint32_t Server<HandlerType>::oneshot_events_(SocketHandler* handler) {
+    handler->update_throttle();
+    uint32_t in = handler->throttled() || handler->closing() ? 0u : uint32_t(EPOLLIN);
+    uint32_t out = handler->pending_output() > 0 ? uint32_t(EPOLLOUT) : 0u;
+    return in | out | EPOLLET | EPOLLONESHOT | EPOLLERR;
+}
+
+// resumes the connections whose input drained(output resumes on its writable event too)
+// closed ones and ones resumed by an event are dropped, their fd may belong to a new connection by now
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+void Server<HandlerType>::check_throttled_(Reactor& reactor) {
+    std::vector<int> throttled;
+    throttled.swap(reactor.throttled);
+    for (int fd : throttled) {
+        if (options_.mode == ServerMode::IO_URING) {
+            auto& conn = reactor.ring_connections[fd];
+            if (conn.handler && !conn.closing && !conn.handler->read_armed()) {
+                ring_throttle_(reactor, fd, conn);
+                ring_flush_(reactor, fd, conn);
+                if (!conn.handler->read_armed()) {
+                    reactor.throttled.push_back(fd);
+                }
+            }
+            continue;
+        }
+        auto* handler = reactor.connections.find(fd);
+        if (handler && !handler->read_armed() && !handler->closing()) {
+            update_events_(reactor, handler);
+            if (!handler->read_armed() && !handler->closing()) {
+                reactor.throttled.push_back(fd);
+            }
+        }
+    }
+}
+
+// errors(and zerocopy completions) first, writable next so queued output leaves before new replies,
+// then whatever process() queued
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+bool Server<HandlerType>::handle_(SocketHandler* handler, uint32_t events, bool quickack) {
+    if ((events & EPOLLERR) && !handler->on_error()) {
+        return false;
+    }
+    if ((events & EPOLLOUT) && !handler->on_writable()) {
+        return false;
+    }
+    if ((events & EPOLLIN) && !handler->closing()) {
+        if (!handler->process()) {
+            return false;
+        }
+        if (quickack) {
+            handler->socket().set_quickack(true);
+        }
+    }
+    if (handler->pending_output() > 0 && !handler->flush()) {
+        return false;
+    }
+    // closing: kept until the output is out, the writable events send the rest
+    return !handler->closing() || handler->pending_output() > 0;
+}
+
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+void Server<HandlerType>::stop() {
+    stop_.store(true);
+    if (started_.load()) {
+        for (auto& reactor : reactors_) {
+            reactor->wake();
+        }
+    }
+}
+
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+bool Server<HandlerType>::send(ConnectionRef ref, std::string data) {
+    return post_(ref, {.op = ReactorTask::SEND, .data = std::move(data)});
+}
+
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+bool Server<HandlerType>::close(ConnectionRef ref) {
+    return post_(ref, {.op = ReactorTask::CLOSE});
+}
+
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+bool Server<HandlerType>::post_(ConnectionRef ref, ReactorTask&& task) {
+    size_t index = ref.id >> 48;
+    if (ref.id == 0 || ref.fd < 0 || !started_.load() || index >= reactors_.size()) {
+        return false;
+    }
+    task.fd = ref.fd;
+    task.id = ref.id;
+    reactors_[index]->post(std::move(task));
+    return true;
+}
+
+// everything posted so far, oldest first
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+void Server<HandlerType>::run_inbox_(Reactor& reactor) {
+    reactor.inbox.drain([this, &reactor](ReactorTask& task) {
+        if (options_.mode == ServerMode::IO_URING) {
+            ring_task_(reactor, task);
+        } else {
+            run_task_(reactor, task);
+        }
+    });
+}
+
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+void Server<HandlerType>::run_task_(Reactor& reactor, ReactorTask& task) {
+    switch (task.op) {
+        case ReactorTask::REARM: {
+            auto* handler = task.handler;
+            handler->set_dispatched(false);
+            uint32_t events = task.events;
+            if (auto it = reactor.parked.find(task.fd); it != reactor.parked.end()) {
+                auto parked = std::move(it->second);
+                reactor.parked.erase(it);
+                for (auto& parked_task : parked) {
+                    if (!deliver_(reactor, handler, parked_task)) {
+                        return;
+                    }
+                }
+                events = oneshot_events_(handler);
             }
+            reactor.epoll.mod(task.fd, events, handler);
+            return;
         }
+        case ReactorTask::CLOSE_HANDLER:
+            task.handler->set_dispatched(false);
+            del_socket_(reactor, task.handler->socket());
+            return;
+        case ReactorTask::SEND:
+        case ReactorTask::CLOSE:
+            break;
+    }
+    // the fd may be closed, or belong to a later connection
+    auto* handler = reactor.connections.find(task.fd);
+    if (!handler || handler->id() != task.id) {
+        return;
+    }
+    if (handler->dispatched()) {
+        reactor.parked[task.fd].push_back(std::move(task));
+        return;
+    }
+    if (!deliver_(reactor, handler, task)) {
+        return;
+    }
+    if (options_.mode == ServerMode::MULTI_REACTOR) {
+        update_events_(reactor, handler);
+    } else if (handler->pending_output() > 0) {
+        reactor.epoll.mod(task.fd, oneshot_events_(handler), handler);
+    }
+    if (timeouts_) {
+        touch_(reactor, task.fd, timeout_(handler, false), TimingWheel::Clock::now());
     }
 }
 
+// a send or close on a handler no one else runs, false if it is closed now
 template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
-bool Server<HandlerType>::init_listen_(unsigned short port) {
+bool Server<HandlerType>::deliver_(Reactor& reactor, SocketHandler* handler, ReactorTask& task) {
+    if (task.op == ReactorTask::SEND) {
+        handler->write(task.data);
+        if (handler->flush()) {
+            return true;
+        }
+    } else {
+        handler->flush();
+    }
+    del_socket_(reactor, handler->socket());
+    return false;
+}
+
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+void Server<HandlerType>::run_ring_(Reactor& reactor) {
+    auto& ring = *reactor.ring;
+    if (ring.accept_multishot(reactor.listen_fd, ring_tag_(RING_ACCEPT, reactor.listen_fd))) {
+        ++reactor.ring_ops;
+    }
+    // the upstream connections and the inbox eventfd stay on epoll, the ring waits for the epoll fd
+    ConnectionPool::set_local(&reactor.upstreams);
+    int epoll_fd = reactor.epoll.fd();
+    if (ring.poll_multishot(epoll_fd, EPOLLIN, ring_tag_(RING_EPOLL, epoll_fd))) {
+        ++reactor.ring_ops;
+    }
+    auto on_cqe = [this, &reactor](const io_uring_cqe& cqe) { on_cqe_(reactor, cqe); };
+    // one io_uring_enter submits everything queued by the last batch and waits for the next
+    while (!stop_.load()) {
+        reactor.sleeping.store(true);
+        if (ring.submit_and_wait(reactor.inbox.empty() ? 1 : 0, wait_ms_(reactor)) == -1) {
+            Log::error("io_uring enter error: {}(errno: {})", std::strerror(errno), errno);
+            break;
+        }
+        reactor.sleeping.store(false, std::memory_order_relaxed);
+        ring.for_each_cqe(on_cqe);
+        if (!reactor.inbox.empty()) {
+            run_inbox_(reactor);
+        }
+        if (!reactor.throttled.empty()) {
+            check_throttled_(reactor);
+        }
+        if (timeouts_) {
+            expire_(reactor, TimingWheel::Clock::now());
+        }
+        if (!reactor.upstreams.empty()) {
+            reactor.upstreams.expire(ConnectionPool::Clock::now());
+        }
+        // after everything that returns buffers
+        if (!reactor.starved.empty() && ring.buffers_free() > 0) {
+            ring_feed_starved_(reactor);
+        }
+    }
+
+    // the kernel may still use the send buffers, wait until every request is done
+    if (ring.cancel_all(ring_tag_(RING_CANCEL, -1))) {
+        ++reactor.ring_ops;
+    }
+    for (int i = 0; reactor.ring_ops > 0 && i < 10; ++i) {
+        ring.submit_and_wait(1, POLL_MS);
+        ring.for_each_cqe(on_cqe);
+    }
+}
+
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+void Server<HandlerType>::on_cqe_(Reactor& reactor, const io_uring_cqe& cqe) {
+    auto op = static_cast<RingOp>(cqe.user_data >> 32);
+    int fd = static_cast<int>(cqe.user_data & 0xffffffff);
+    bool last = !(cqe.flags & IORING_CQE_F_MORE);
+    bool stopping = stop_.load(std::memory_order_relaxed);
+    if (last) {
+        --reactor.ring_ops;
+    }
+    if (op == RING_ACCEPT) {
+        if (cqe.res >= 0) {
+            if (stopping) {
+                ::close(cqe.res);
+            } else {
+                ring_accept_(reactor, cqe.res);
+            }
+        } else if (cqe.res == -EMFILE || cqe.res == -ENFILE) {
+            Log::error("io_uring accept error: {}, connection dropped", std::strerror(-cqe.res));
+            reactor.shed_connection(fd);
+        } else if (cqe.res != -ECANCELED) {
+            Log::error("io_uring accept error: {}", std::strerror(-cqe.res));
+        }
+        if (last && !stopping && reactor.ring->accept_multishot(fd, cqe.user_data)) {
+            ++reactor.ring_ops;
+        }
+        return;
+    }
+    if (op == RING_EPOLL) {
+        // up to MAX_EVENTS per wait, the multishot poll does not fire again for what is left
+        int n;
+        do {
+            n = reactor.epoll.wait(0);
+            for (int i = 0; i < n; ++i) {
+                void* ptr = reactor.epoll.get_ptr(i);
+                if (ptr == &reactor.inbox) {
+                    reactor.woken();
+                    continue;
+                }
+                reactor.upstreams.handle(static_cast<UpstreamHandler*>(ptr), reactor.epoll.get_events(i));
+            }
+        } while (n == Reactor::MAX_EVENTS);
+        if (last && !stopping && reactor.ring->poll_multishot(fd, EPOLLIN, cqe.user_data)) {
+            ++reactor.ring_ops;
+        }
+        return;
+    }
+
+    if (fd < 0 || static_cast<size_t>(fd) >= reactor.ring_connections.size() || !reactor.ring_connections[fd].handler) {
+        return;
+    }
+    auto& conn = reactor.ring_connections[fd];
+    if (last) {
+        --conn.ops;
+    }
+    switch (op) {
+        case RING_RECV:
+            if (cqe.res > 0) {
+                auto id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                if (conn.closing) {
+                    reactor.ring->return_buffer(id);
+                } else if (!conn.handler->read_armed() || !conn.held.empty()) {
+                    // completed before the cancel of the throttle, kept in its buffer until resumed
+                    conn.held.emplace_back(id, cqe.res);
+                } else {
+                    ring_recv_(reactor, fd, conn, id, cqe.res);
+                }
+            } else if (cqe.res != -ENOBUFS && cqe.res != -ECANCELED) {  // 0 is closed by peer
+                ring_close_(reactor, fd, conn);
+            }
+            break;
+        case RING_POLL:
+        case RING_WRITABLE:
+            if (op == RING_WRITABLE) {
+                conn.handler->set_write_armed(false);
+            }
+            if (cqe.res > 0 && !conn.closing && !handle_(conn.handler, static_cast<uint32_t>(cqe.res), quickack_)) {
+                ring_close_(reactor, fd, conn);
+            } else if (cqe.res < 0 && cqe.res != -ECANCELED) {
+                ring_close_(reactor, fd, conn);
+            }
+            break;
+        case RING_SEND:
+            if (cqe.res < 0) {
+                conn.reply.clear();
+                ring_close_(reactor, fd, conn);
+                break;
+            }
+            conn.sent += cqe.res;
+            if (conn.sent < conn.sending.size()) {
+                if (reactor.ring->send(fd, conn.sending.data() + conn.sent, conn.sending.size() - conn.sent, cqe.user_data)) {
+                    ++conn.ops;
+                    ++reactor.ring_ops;
+                }
+                break;
+            }
+            conn.sending.clear();
+            conn.sent = 0;
+            break;
+        default:  // shutdown, cancel
+            break;
+    }
+
+    if (last && cqe.user_data == conn.armed) {
+        conn.armed = 0;
+        // ran out of provided buffers, or the kernel ended the multishot request(not if cancelled by the throttle)
+        // while none are free(held by throttled connections) a new recv fails the same way at once: it waits
+        if (!conn.closing && !stopping && conn.handler->read_armed()) {
+            if (cqe.res == -ENOBUFS && reactor.ring->buffers_free() == 0) {
+                reactor.starved.push_back(fd);
+            } else {
+                ring_arm_(reactor, fd, conn);
+            }
+        }
+    }
+    auto* handler = conn.handler;
+    ring_writable_(reactor, fd, conn);
+    if (stopping && !conn.closing) {
+        conn.reply.clear();
+        ring_close_(reactor, fd, conn);
+    }
+    if (!conn.closing && !stopping) {
+        ring_throttle_(reactor, fd, conn);
+    }
+    ring_flush_(reactor, fd, conn);
+    if (conn.closing && conn.ops == 0) {
+        conn = {};
+        reactor.timers.remove(fd);
+        reactor.connections.erase(fd);  // closes the socket
+        return;
+    }
+    if (timeouts_) {
+        bool sending = !conn.sending.empty() || !conn.reply.empty();
+        touch_(reactor, fd, timeout_(handler, sending), TimingWheel::Clock::now());
+    }
+}
+
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+void Server<HandlerType>::ring_accept_(Reactor& reactor, int fd) {
+    auto* handler = reactor.connections.emplace<HandlerType>(fd);
+    handler->set_socket(Socket::adopt(fd));
+    handler->set_id(reactor.new_id());
+    handler->socket().apply(options_.accepted_socket);
+    set_watermarks_(handler);
+    Log::info("new connection from {}:{}", handler->socket().get_peer_ip(), handler->socket().get_peer_port());
+    if (static_cast<size_t>(fd) >= reactor.ring_connections.size()) {
+        reactor.ring_connections.resize(std::max<size_t>(fd + 1, reactor.ring_connections.size() * 2));
+    }
+    auto& conn = reactor.ring_connections[fd];
+    conn.handler = handler;
+    ring_arm_(reactor, fd, conn);
+    if (!conn.armed) {
+        conn = {};
+        reactor.connections.erase(fd);
+        return;
+    }
+    if (timeouts_) {
+        touch_(reactor, fd, options_.read_timeout, TimingWheel::Clock::now());
+    }
+}
+
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+void Server<HandlerType>::ring_arm_(Reactor& reactor, int fd, RingConnection& conn) {
+    bool ok;
+    if constexpr (std::is_base_of_v<StreamHandler, HandlerType>) {
+        conn.armed = ring_tag_(RING_RECV, fd);
+        ok = reactor.ring->recv_multishot(fd, 0, conn.armed);
+    } else {
+        conn.armed = ring_tag_(RING_POLL, fd);
+        ok = reactor.ring->poll_multishot(fd, EPOLLIN, conn.armed);
+    }
+    if (!ok) {
+        Log::error("io_uring submission queue full");
+        conn.armed = 0;
+        return;
+    }
+    ++conn.ops;
+    ++reactor.ring_ops;
+}
+
+// at most one send in flight per connection, the last one is linked to a shutdown
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+void Server<HandlerType>::ring_flush_(Reactor& reactor, int fd, RingConnection& conn) {
+    if (!conn.sending.empty() || conn.reply.empty()) {
+        return;
+    }
+    conn.sending.swap(conn.reply);
+    if (!reactor.ring->send(fd, conn.sending.data(), conn.sending.size(), ring_tag_(RING_SEND, fd), conn.closing)) {
+        Log::error("io_uring submission queue full");
+        conn.sending.clear();
+        return;
+    }
+    ++conn.ops;
+    ++reactor.ring_ops;
+    if (conn.closing && reactor.ring->shutdown(fd, SHUT_WR, ring_tag_(RING_SHUTDOWN, fd))) {
+        ++conn.ops;
+        ++reactor.ring_ops;
+    }
+}
+
+// output process() queued but the socket did not take
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+void Server<HandlerType>::ring_writable_(Reactor& reactor, int fd, RingConnection& conn) {
+    auto* handler = conn.handler;
+    if (!conn.closing && handler->pending_output() > 0 && !handler->write_armed()
+            && reactor.ring->poll(fd, EPOLLOUT, ring_tag_(RING_WRITABLE, fd))) {
+        handler->set_write_armed(true);
+        ++conn.ops;
+        ++reactor.ring_ops;
+    }
+}
+
+// buffers came back, the recvs that ran out are armed again(closed ones and ones armed meanwhile are dropped,
+// their fd may belong to a new connection by now)
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+void Server<HandlerType>::ring_feed_starved_(Reactor& reactor) {
+    std::vector<int> starved;
+    starved.swap(reactor.starved);
+    for (int fd : starved) {
+        auto& conn = reactor.ring_connections[fd];
+        if (conn.handler && !conn.closing && !conn.armed && conn.handler->read_armed()) {
+            ring_arm_(reactor, fd, conn);
+        }
+    }
+}
+
+// Server::send / close: a StreamHandler's send joins its replies, other handlers queue it like process() does
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+void Server<HandlerType>::ring_task_(Reactor& reactor, ReactorTask& task) {
+    int fd = task.fd;
+    if (fd < 0 || static_cast<size_t>(fd) >= reactor.ring_connections.size()) {
+        return;
+    }
+    auto& conn = reactor.ring_connections[fd];
+    if (!conn.handler || conn.handler->id() != task.id || conn.closing) {
+        return;
+    }
+    if (task.op == ReactorTask::CLOSE) {
+        ring_close_(reactor, fd, conn);
+    } else if constexpr (std::is_base_of_v<StreamHandler, HandlerType>) {
+        conn.reply += task.data;
+        ring_throttle_(reactor, fd, conn);
+    } else {
+        conn.handler->write(task.data);
+        if (conn.handler->flush()) {
+            ring_writable_(reactor, fd, conn);
+        } else {
+            ring_close_(reactor, fd, conn);
+        }
+    }
+    ring_flush_(reactor, fd, conn);
+    if (conn.closing && conn.ops == 0) {
+        conn = {};
+        reactor.timers.remove(fd);
+        reactor.connections.erase(fd);
+        return;
+    }
+    if (timeouts_) {
+        bool sending = !conn.sending.empty() || !conn.reply.empty();
+        touch_(reactor, fd, timeout_(conn.handler, sending), TimingWheel::Clock::now());
+    }
+}
+
+// the connection goes away once its last request completed
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+void Server<HandlerType>::ring_close_(Reactor& reactor, int fd, RingConnection& conn) {
+    if (conn.closing) {
+        return;
+    }
+    conn.closing = true;
+    for (auto [id, len] : conn.held) {
+        reactor.ring->return_buffer(id);
+    }
+    conn.held.clear();
+    if (conn.armed && reactor.ring->cancel(conn.armed, ring_tag_(RING_CANCEL, fd))) {
+        ++conn.ops;
+        ++reactor.ring_ops;
+    }
+}
+
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+void Server<HandlerType>::ring_recv_(Reactor& reactor, int fd, RingConnection& conn, uint16_t id, unsigned len) {
+    bool open = true;
+    if constexpr (std::is_base_of_v<StreamHandler, HandlerType>) {
+        open = static_cast<HandlerType*>(conn.handler)->on_recv(reactor.ring->buffer(id, len), conn.reply);
+    }
+    reactor.ring->return_buffer(id);
+    if (quickack_ && open) {
+        conn.handler->socket().set_quickack(true);
+    }
+    if (!open) {
+        ring_close_(reactor, fd, conn);
+    }
+}
+
+// a throttled connection has no recv armed: cancelled when the throttle starts, armed again when it ends
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+void Server<HandlerType>::ring_throttle_(Reactor& reactor, int fd, RingConnection& conn) {
+    auto* handler = conn.handler;
+    auto queued = [&conn] { return conn.reply.size() + conn.sending.size() - conn.sent; };
+    handler->update_throttle(queued());
+    bool read = !handler->throttled();
+    if (read == handler->read_armed()) {
+        return;
+    }
+    if (read) {
+        // what came in meanwhile goes first, it may throttle again
+        size_t i = 0;
+        while (i < conn.held.size() && !conn.closing && !handler->throttled()) {
+            ring_recv_(reactor, fd, conn, conn.held[i].first, conn.held[i].second);
+            ++i;
+            handler->update_throttle(queued());
+        }
+        if (conn.closing) {  // the held buffers went back with the close
+            return;
+        }
+        conn.held.erase(conn.held.begin(), conn.held.begin() + i);
+        if (handler->throttled()) {
+            return;
+        }
+        handler->set_read_armed(true);
+        if (!conn.armed) {  // else the cancelled request ends and is armed again
+            ring_arm_(reactor, fd, conn);
+        }
+        return;
+    }
+    handler->set_read_armed(false);
+    reactor.throttled.push_back(fd);
+    if (conn.armed && reactor.ring->cancel(conn.armed, ring_tag_(RING_CANCEL, fd))) {
+        ++conn.ops;
+        ++reactor.ring_ops;
+    }
+}
+
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+bool Server<HandlerType>::init_listen_(Reactor& reactor, unsigned short port, int shared_fd) {
+    if constexpr (std::is_base_of_v<DatagramHandler, HandlerType>) {
+        return init_datagram_(reactor, port);
+    }
     Socket listen_socket_;
-    if (!listen_socket_.init(SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC)) {
+    if (shared_fd != -1) {
+        // the same listening socket through an fd of our own
+        int fd = fcntl(shared_fd, F_DUPFD_CLOEXEC, 0);
+        if (fd == -1) {
+            Log::error("listen socket dup error: {}(errno: {})", std::strerror(errno), errno);
+            return false;
+        }
+        listen_socket_ = Socket::adopt(fd);
+    } else if (!options_.unix_path.empty()) {
+        if (!listen_unix_(listen_socket_)) {
+            return false;
+        }
+    } else {
+        if (!listen_socket_.init(SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC)) {
+            Log::error("socket init error: {}(errno: {})", std::strerror(errno), errno);
+            return false;
+        }
+        if (!listen_socket_.set_reuse_addr()) {
+            Log::error("socket set reuse addr error: {}(errno: {})", std::strerror(errno), errno);
+            return false;
+        }
+        // every reactor binds its own socket, the kernel spreads new connections over them
+        if (options_.mode != ServerMode::THREAD_POOL && options_.reuse_port && !listen_socket_.set_reuse_port()) {
+            Log::error("socket set reuse port error: {}(errno: {})", std::strerror(errno), errno);
+            return false;
+        }
+        if (!listen_socket_.apply(options_.listen_socket)) {
+            return false;
+        }
+        if (!listen_socket_.bind("0.0.0.0", port)) {
+            Log::error("socket bind error: {}(errno: {})", std::strerror(errno), errno);
+            return false;
+        }
+        if (!listen_socket_.listen(options_.backlog)) {
+            Log::error("socket listen error: {}(errno: {})", std::strerror(errno), errno);
+            return false;
+        }
+    }
+    int fd = listen_socket_.fd();
+    auto listen_handler_ = std::make_unique<ListenHandler<HandlerType>>(std::move(listen_socket_), *this, reactor);
+    if (options_.mode == ServerMode::IO_URING) {
+        reactor.ring = std::make_unique<IoUring>(Reactor::RING_ENTRIES);
+        if (!reactor.ring->ok() || !reactor.ring->init_buffers(0, Reactor::RING_BUFFERS, Reactor::RING_BUFFER_SIZE)) {
+            Log::error("io_uring init error: {}(errno: {})", std::strerror(errno), errno);
+            return false;
+        }
+        reactor.listen_fd = fd;
+        reactor.listener = std::move(listen_handler_);
+        return true;
+    }
+    // level triggered: what accept_batch left is reported again
+    // EPOLLEXCLUSIVE: a connection wakes one of the reactors sharing the socket, not all of them
+    uint32_t events = shared_listener_() ? EPOLLIN | EPOLLEXCLUSIVE : EPOLLIN;
+    if (!reactor.epoll.add(fd, events, listen_handler_.get())) {
+        Log::error("epoll add fd error: {}(errno: {})", std::strerror(errno), errno);
+        return false;
+    }
+    reactor.listener = std::move(listen_handler_);
+    return true;
+}
+
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+bool Server<HandlerType>::listen_unix_(Socket& socket) {
+    auto& path = options_.unix_path;
+    if (!socket.init(options_.unix_type | SOCK_NONBLOCK | SOCK_CLOEXEC, AF_UNIX)) {
         Log::error("socket init error: {}(errno: {})", std::strerror(errno), errno);
         return false;
     }
-    if (!listen_socket_.set_reuse_addr()) {
-        Log::error("socket set reuse addr error: {}(errno: {})", std::strerror(errno), errno);
+    // a path bound by a server that is gone stays behind, only a socket file is removed
+    struct stat st;
+    if (path[0] != '@' && ::stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+        ::unlink(path.c_str());
+    }
+    if (!socket.apply(options_.listen_socket)) {
         return false;
     }
-    if (!listen_socket_.bind("0.0.0.0", port)) {
-        Log::error("socket bind error: {}(errno: {})", std::strerror(errno), errno);
+    if (!socket.bind_unix(path)) {
+        Log::error("socket bind {} error: {}(errno: {})", path, std::strerror(errno), errno);
         return false;
     }
-    if (!listen_socket_.listen()) {
+    if (!socket.listen(options_.backlog)) {
         Log::error("socket listen error: {}(errno: {})", std::strerror(errno), errno);
         return false;
     }
-    int fd = listen_socket_.fd();
-    auto listen_handler_ = std::make_unique<ListenHandler<HandlerType>>(std::move(listen_socket_), *this);
-    if (!epoll_.add(fd, EPOLLIN, listen_handler_.get())) {  // maybe EPOLLET
+    return true;
+}
+
+// a DatagramHandler in place of the listener: bound udp socket per reactor(SO_REUSEPORT spreads the flows),
+// handled on the reactor thread in every mode
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+bool Server<HandlerType>::init_datagram_(Reactor& reactor, unsigned short port) {
+    if (!options_.unix_path.empty()) {
+        Log::error("server: DatagramHandler is udp only, no unix_path");
+        return false;
+    }
+    Socket socket;
+    if (!socket.init(SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC)) {
+        Log::error("socket init error: {}(errno: {})", std::strerror(errno), errno);
+        return false;
+    }
+    if (!socket.set_reuse_addr() || !socket.set_reuse_port()) {
+        Log::error("socket set reuse error: {}(errno: {})", std::strerror(errno), errno);
+        return false;
+    }
+    if (!socket.apply(options_.listen_socket)) {
+        return false;
+    }
+    if (!socket.bind("0.0.0.0", port)) {
+        Log::error("socket bind error: {}(errno: {})", std::strerror(errno), errno);
+        return false;
+    }
+    int fd = socket.fd();
+    auto handler = std::make_unique<HandlerType>();
+    handler->set_socket(std::move(socket));
+    if (!reactor.epoll.add(fd, EPOLLIN, handler.get())) {
         Log::error("epoll add fd error: {}(errno: {})", std::strerror(errno), errno);
         return false;
     }
-    handlers_map_[fd] = std::move(listen_handler_);
+    reactor.listener = std::move(handler);
     return true;
 }
 
 template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
-void Server<HandlerType>::del_socket_(Socket& socket) {
-    if (!epoll_.del(socket)) {
+void Server<HandlerType>::colocate_() {
+    auto& nodes = numa_nodes();
+    int node = options_.node >= 0 ? options_.node : numa_node_of(current_cpu());
+    if (node < 0 || node >= static_cast<int>(nodes.size()) || nodes[node].empty()) {
+        Log::error("server colocate: no cpu on node {}", node);
+        return;
+    }
+    if (!set_thread_affinity(nodes[node])) {
+        Log::error("server set affinity error");
+        return;
+    }
+    set_thread_name("reactor");
+    thread_pool_.set_placement({.placement = Placement::CPU_SET, .node = node, .name = "handler"});
+    Log::info("server reactor and workers on node {}", node);
+}
+
+// runs on the reactor's own thread
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+void Server<HandlerType>::place_reactor_(int index) {
+    set_thread_name("reactor/" + std::to_string(index));
+    if (!options_.colocate) {
+        return;
+    }
+    PlacementPolicy policy{.placement = Placement::SPREAD};
+    if (options_.node >= 0) {
+        policy = {.placement = Placement::PACK, .node = options_.node};
+    }
+    auto cpus = policy.cpus_for(index);
+    if (!set_thread_affinity(cpus)) {
+        Log::error("server set affinity error");
+        return;
+    }
+    // the SO_REUSEPORT group hands the connections whose packets this cpu handles to this reactor
+    if (!shared_listener_() && cpus.size() == 1 && !options_.listen_socket.incoming_cpu) {
+        reactors_[index]->listener->socket().set_incoming_cpu(cpus[0]);
+    }
+}
+
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+void Server<HandlerType>::del_socket_(Reactor& reactor, Socket& socket) {
+    if (!reactor.epoll.del(socket)) {
         Log::error("epoll del fd error: {}(errno: {})", std::strerror(errno), errno);
     }
-    handlers_map_.erase(socket);
+    reactor.timers.remove(socket.fd());
+    reactor.parked.erase(socket.fd());
+    reactor.connections.erase(socket);
 }
 
+// sending: output the handler does not know about(io_uring sends in flight)
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+std::chrono::milliseconds Server<HandlerType>::timeout_(SocketHandler* handler, bool sending) const {
+    if (sending || handler->pending_output() > 0) {
+        return options_.write_timeout;
+    }
+    return handler->reading() ? options_.read_timeout : options_.keepalive_timeout;
+}
+
+// on every event of the connection, O(1)
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+void Server<HandlerType>::touch_(Reactor& reactor, int fd, std::chrono::milliseconds timeout,
+                                 TimingWheel::Clock::time_point now) {
+    if (!timeouts_) {
+        return;
+    }
+    if (timeout.count() > 0) {
+        reactor.timers.reset(fd, timeout, now);
+    } else {
+        reactor.timers.remove(fd);
+    }
+}
+
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+void Server<HandlerType>::expire_(Reactor& reactor, TimingWheel::Clock::time_point now) {
+    reactor.timers.expire(now, [this, &reactor](int fd) {
+        Log::info("connection timed out");
+        if (options_.mode == ServerMode::IO_URING) {
+            auto& conn = reactor.ring_connections[fd];
+            conn.reply.clear();
+            ring_close_(reactor, fd, conn);
+            // a peer that does not read keeps the send from completing
+            if (!conn.sending.empty() && reactor.ring->cancel(ring_tag_(RING_SEND, fd), ring_tag_(RING_CANCEL, fd))) {
+                ++conn.ops;
+                ++reactor.ring_ops;
+            }
+            if (conn.handler->write_armed()
+                    && reactor.ring->cancel(ring_tag_(RING_WRITABLE, fd), ring_tag_(RING_CANCEL, fd))) {
+                ++conn.ops;
+                ++reactor.ring_ops;
+            }
+            return;
+        }
+        auto* handler = reactor.connections.find(fd);
+        if (!handler) {
+            return;
+        }
+        if (options_.mode == ServerMode::THREAD_POOL) {
+            // a task may be running the handler, the peer is cut off and the EPOLLHUP that follows closes it
+            ::shutdown(fd, SHUT_RDWR);
+            return;
+        }
+        del_socket_(reactor, handler->socket());
+    });
+}
+
+// wake up for the next timer tick or pool deadline, -1 sleeps until an event(stop() and the inbox write the eventfd)
+template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
+int Server<HandlerType>::wait_ms_(const Reactor& reactor) const {
+    int ms = timeouts_ ? reactor.timers.next_timeout_ms() : -1;
+    if (!reactor.upstreams.empty()) {
+        int pool_ms = reactor.upstreams.next_timeout_ms(ConnectionPool::Clock::now());
+        ms = ms == -1 || (pool_ms != -1 && pool_ms < ms) ? pool_ms : ms;
+    }
+    if (!reactor.throttled.empty()) {  // input may drain without an event
+        ms = ms == -1 ? POLL_MS : std::min(ms, POLL_MS);
+    }
+    return ms;
+}
+
+// accepts until EAGAIN or accept_batch connections
 template <typename HandlerType> requires std::is_base_of_v<SocketHandler, HandlerType>
 bool ListenHandler<HandlerType>::process() {
-    if (auto ret = socket_.accept(SOCK_NONBLOCK | SOCK_CLOEXEC)) {
+    int batch = server_.options_.accept_batch;
+    uint32_t events = server_.options_.mode == ServerMode::MULTI_REACTOR ? EPOLLIN : EPOLLIN | EPOLLET | EPOLLONESHOT;
+    for (int i = 0; batch <= 0 || i < batch; ++i) {
+        auto ret = socket_.accept(SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (!ret) {
+            if (errno == EAGAIN) {
+                return true;
+            }
+            if (errno == ECONNABORTED || errno == EINTR) {  // that connection is gone, not the listener
+                continue;
+            }
+            if (errno == EMFILE || errno == ENFILE) {
+                Log::error("socket accept error: {}, connection dropped", std::strerror(errno));
+                if (reactor_.shed_connection(socket_.fd())) {
+                    continue;
+                }
+                return true;
+            }
+            Log::error("socket accept error");
+            return false;
+        }
         auto socket = std::move(*ret);
         Log::info("new connection from {}:{}", socket.get_peer_ip(), socket.get_peer_port());
         auto fd = socket.fd();
 
-        auto handler = std::make_unique<HandlerType>();
+        auto* handler = reactor_.connections.template emplace<HandlerType>(fd);
         handler->set_socket(std::move(socket));
-        if (!server_.epoll_.add(fd, EPOLLIN | EPOLLET | EPOLLONESHOT, handler.get())) {
+        handler->set_id(reactor_.new_id());
+        handler->socket().apply(server_.options_.accepted_socket);
+        server_.set_watermarks_(handler);
+        if (!reactor_.epoll.add(fd, events, handler)) {
             Log::error("epoll add fd error");
-            return false;
+            reactor_.connections.erase(fd);
+            continue;
         }
-        server_.handlers_map_[fd] = std::move(handler);
-        return true;
-    } else {
-        if (errno == EAGAIN) {
-            return true;
+        if (server_.timeouts_) {
+            server_.touch_(reactor_, fd, server_.options_.read_timeout, TimingWheel::Clock::now());
         }
-        Log::error("socket accept error");
-        return false;
     }
+    return true;
 }
 
 }  // namespace wheel
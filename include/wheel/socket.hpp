@@ -4,13 +4,32 @@
 
 #include <arpa/inet.h>  // htons
 #include <sys/socket.h>
+#include <sys/uio.h>  // iovec
 #include <unistd.h>  // close
 #include <optional>
 #include <span>  // c++20
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace wheel {
 
+// typed socket options, unset ones keep the kernel default
+struct SocketOptions {
+    std::optional<bool> nodelay{};  // TCP_NODELAY: small writes go out at once instead of waiting for an ack(Nagle)
+    std::optional<bool> cork{};  // TCP_CORK: only full segments go out until uncorked(or 200 ms passed)
+    // TCP_QUICKACK: ack at once instead of delayed, the kernel falls back to delayed acks by itself later
+    std::optional<bool> quickack{};
+    std::optional<int> recv_buffer{};  // SO_RCVBUF bytes(the kernel doubles it), turns off receive buffer autotuning
+    std::optional<int> send_buffer{};  // SO_SNDBUF bytes
+    std::optional<int> busy_poll{};  // SO_BUSY_POLL: microseconds a read with nothing queued spins on the device queue
+    // listening socket only
+    std::optional<int> defer_accept{};  // TCP_DEFER_ACCEPT: seconds, a connection is accepted once its first data arrived
+    std::optional<int> fastopen{};  // TCP_FASTOPEN: queue length of pending data-in-SYN connections, 0 turns it off
+    // in a SO_REUSEPORT group a connection goes to the socket whose cpu handled the packet
+    std::optional<int> incoming_cpu{};
+};
+
 class Socket {
 public:
     Socket() {}
@@ -34,18 +53,72 @@ public:
 
     operator int() const { return fd_; }
 
-    bool init(int flags = 0);
+    // take ownership of an fd accepted elsewhere(io_uring), the peer address comes from getpeername
+    static Socket adopt(int fd);
+    // connected AF_UNIX pair(socketpair), flags as for init
+    static std::optional<std::pair<Socket, Socket>> pair(int flags = SOCK_STREAM);
+
+    bool init(int flags = 0, int domain = AF_INET);
     bool bind(std::string_view ip, unsigned short port);
-    bool listen();
+    bool listen(int backlog = 128);
     std::optional<Socket> accept(int flags = 0);
+    // ipv6 if ip has a ':'(init with AF_INET6)
+    // non-blocking socket: false with errno EINPROGRESS while connecting, done once writable, see error()
     bool connect(std::string_view ip, unsigned short port);
+    // AF_UNIX(init with that domain), a path starting with '@' is in the abstract namespace:
+    // no file, gone with the last socket bound to it
+    bool bind_unix(std::string_view path);
+    bool connect_unix(std::string_view path);
     bool close();
+    // pending error(SO_ERROR), cleared by reading it: 0 if a non-blocking connect succeeded
+    int error();
 
     bool set_reuse_addr();
+    bool set_reuse_port();
+    bool set_nodelay(bool on);
+    bool set_cork(bool on);
+    bool set_quickack(bool on);
+    bool set_recv_buffer(int bytes);
+    bool set_send_buffer(int bytes);
+    bool set_busy_poll(int usec);
+    bool set_defer_accept(int seconds);
+    bool set_fastopen(int queue);
+    bool set_incoming_cpu(int cpu);
+    // every set option of options, the ones the socket refuses are logged, false if any was
+    bool apply(const SocketOptions& options);
+    bool set_zerocopy();  // SO_ZEROCOPY, needed before send_zerocopy
+    bool set_gro();  // UDP_GRO, datagrams of a flow arrive coalesced with their segment size in a cmsg
+    bool set_gso(uint16_t segment);  // UDP_SEGMENT for every send, 0 turns it off(a send's cmsg still may)
 
     int send(std::string_view s);
+    // more: MSG_MORE, a partial segment waits for the next send like with TCP_CORK
+    // may write less than asked on a non-blocking socket
+    int writev(const iovec* iov, int count, bool more = false);
+
+    // the pages of s are sent by the kernel, s must stay unchanged until a completion covers this send
+    // every successful call gets the next sequence number, counting from 0
+    int send_zerocopy(std::string_view s);
+    // one completion from the error queue: sends [lo, hi] are done, copied if the kernel fell back to a copy
+    // false when there is none(left)
+    bool read_zerocopy_completion(uint32_t& lo, uint32_t& hi, bool& copied);
+    // file region without passing through user space, offset is advanced
+    long sendfile(int file_fd, long& offset, size_t count);
+    // from a pipe without passing through user space
+    long splice_from(int pipe_fd, size_t count);
     int recv(std::span<char> buf);
+    // scatter into several buffers with one syscall
+    int readv(const iovec* iov, int count);
+    // datagrams(SOCK_DGRAM), a batch per syscall, return how many or -1
+    int recvmmsg(mmsghdr* msgs, unsigned count);
+    int sendmmsg(mmsghdr* msgs, unsigned count);
+    // AF_UNIX: the fds go along with s(SCM_RIGHTS, at least one byte of it), the peer gets duplicates
+    int send_fds(std::string_view s, std::span<const int> fds);
+    // received fds are appended to fds(close-on-exec), they arrive with the first byte of the send that carried them
+    int recv_fds(std::span<char> buf, std::vector<int>& fds);
+
+    static constexpr size_t MAX_FDS = 253;  // per send, SCM_MAX_FD
 
+    // AF_UNIX: the peer's path('@' for abstract), empty for an unbound peer, port 0
     const std::string& get_peer_ip() const { return ip_; }
     unsigned short get_peer_port() const { return port_; }
 
@@ -57,6 +130,8 @@ public:
 private:
     Socket(int fd, std::string_view ip, unsigned short port) : fd_(fd), ip_(ip), port_(port) {}
 
+    bool set_option_(int level, int name, int value);
+
     int fd_ = -1;
     std::string ip_ = "";
     unsigned short port_ = 0;
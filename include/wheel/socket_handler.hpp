@@ -3,21 +3,137 @@
 #include <wheel/epoll.hpp>
 #include <wheel/socket.hpp>
 
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
 namespace wheel {
 
+// limits of a connection's buffered bytes, 0 high disables
+struct Watermarks {
+    size_t high = 0;
+    size_t low = 0;
+};
+
+// a connection of a Server, for Server::send / close from any thread
+struct ConnectionRef {
+    int fd = -1;
+    uint64_t id = 0;  // tells a later connection on the same fd apart, 0 for none
+};
+
 class SocketHandler {
 public:
     SocketHandler() = default;
     SocketHandler(Socket&& socket) : socket_(std::move(socket)) {}
-    virtual ~SocketHandler() = default;
+    virtual ~SocketHandler();
 
     virtual bool process() = 0;
+    // the socket is writable again(EPOLLOUT)
+    virtual bool on_writable() { return flush(); }
+    // EPOLLERR: zerocopy completions or a socket error
+    virtual bool on_error();
+    // part of a request is buffered, the server applies the read timeout instead of the keepalive one
+    virtual bool reading() const { return false; }
+    // received requests not processed yet(queued for later, not a partial message that needs more reads),
+    // held against the input watermarks
+    virtual size_t pending_input() const { return 0; }
+    // throttled() turned on / off, e.g. to tell a pipelining peer to slow down
+    virtual void on_throttle() {}
+    virtual void on_unthrottle() {}
+    // an UpstreamHandler: its events go to the ConnectionPool that owns it
+    virtual bool upstream() const { return false; }
 
     void set_socket(Socket&& socket) { socket_ = std::move(socket); }
     Socket& socket() { return socket_; }
 
+    // queue data for the socket, small writes are coalesced, nothing is sent before flush()
+    // the server flushes after process() returned, call flush() earlier to send right away
+    void write(std::string_view data);
+    // large buffers(64 KiB and up) without the copy into the kernel, kept alive until the kernel is done with them:
+    // past the handler too, destroyed with sends in flight it shuts the socket down(FIN) and a dup of it waits
+    // for the completions, reaped by later flushes
+    // a socket closed through socket().close() before the handler goes away releases them early
+    void write_zerocopy(std::shared_ptr<const std::string> data);
+    // file region with sendfile, the fd is dup'ed so the caller may close it
+    bool write_file(int fd, long offset, size_t count);
+    // writev / send / sendfile as much as the socket takes, the rest goes out when the socket is writable
+    // false only on a socket error
+    bool flush();
+    size_t pending_output() const { return out_bytes_; }
+    // stop reading and close once the queued output is sent, e.g. after the peer half-closed: it still gets the
+    // whole reply when that is more than the socket takes at once
+    void close_after_output() { closing_ = true; }
+    bool closing() const { return closing_; }
+    // zerocopy buffers the kernel still uses
+    size_t zerocopy_in_flight() const { return zerocopy_.size(); }
+
+    // server bookkeeping: EPOLLOUT is armed for this socket, reading was not stopped by the throttle
+    bool write_armed() const { return write_armed_; }
+    void set_write_armed(bool armed) { write_armed_ = armed; }
+    bool read_armed() const { return read_armed_; }
+    void set_read_armed(bool armed) { read_armed_ = armed; }
+    // THREAD_POOL: a worker runs the handler, the reactor leaves it alone until the worker hands it back
+    bool dispatched() const { return dispatched_; }
+    void set_dispatched(bool dispatched) { dispatched_ = dispatched; }
+    // set by the server at accept
+    uint64_t id() const { return id_; }
+    void set_id(uint64_t id) { id_ = id; }
+    ConnectionRef ref() const { return {socket_.fd(), id_}; }
+    // backpressure limits, set by the server(none by default)
+    void set_watermarks(const Watermarks& input, const Watermarks& output);
+    // input or output went above its high watermark and is not back at the low one yet, nothing should be read
+    bool throttled() const { return input_throttled_ || output_throttled_; }
+    // re-evaluates throttled() and calls the callbacks, true if it changed
+    // queued: output not in the queue yet(a reply being built, io_uring sends in flight)
+    bool update_throttle(size_t queued = 0);
+
+    static constexpr size_t COALESCE_SIZE = 4096;  // writes are appended to the last chunk up to this size
+    static constexpr int MAX_IOV = 64;  // chunks per writev
+
 protected:
     Socket socket_;
+
+private:
+    struct Chunk {
+        std::string data;
+        std::shared_ptr<const std::string> shared;  // write_zerocopy
+        int file = -1;  // write_file
+        long offset = 0;  // sent bytes, or the file position
+        size_t size = 0;  // of the file region
+
+        size_t left() const { return file != -1 ? size : (shared ? shared->size() : data.size()) - offset; }
+    };
+    struct Zerocopy {
+        uint32_t seq;
+        std::shared_ptr<const std::string> data;
+    };
+
+    int flush_copy_();
+    int flush_zerocopy_(Chunk& chunk);
+    int flush_file_(Chunk& chunk);
+    void reap_zerocopy_();
+    void linger_();
+    bool out_empty_() const { return out_head_ == out_.size(); }
+    void pop_();
+
+    // vectors, not deques: a default constructed handler allocates nothing
+    std::vector<Chunk> out_;
+    size_t out_head_ = 0;  // chunks before it are sent
+    size_t out_bytes_ = 0;
+    std::vector<Zerocopy> zerocopy_;  // sent, waiting for the completion
+    uint32_t zerocopy_seq_ = 0;
+    int zerocopy_state_ = 0;  // 0: not tried, 1: on, -1: unsupported or the kernel copies anyway
+    bool write_armed_ = false;
+    bool read_armed_ = true;
+    bool dispatched_ = false;
+    bool closing_ = false;
+    uint64_t id_ = 0;
+    Watermarks input_marks_;
+    Watermarks output_marks_;
+    bool input_throttled_ = false;
+    bool output_throttled_ = false;
 };
 
 }  // namespace wheel
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <wheel/socket_handler.hpp>
+
+#include <span>
+#include <string>
+
+namespace wheel {
+
+// handler driven by the bytes received, works with every Server backend:
+// epoll calls process() which recvs itself, io_uring hands over the data of a multishot recv
+class StreamHandler : public SocketHandler {
+public:
+    StreamHandler() = default;
+    virtual ~StreamHandler() = default;
+
+    bool process() override;
+
+    // data is only valid during the call, append the response to reply
+    // return false to close the connection(after reply is sent)
+    virtual bool on_recv(std::span<const char> data, std::string& reply) = 0;
+
+protected:
+    std::string reply_;  // of the current process(), moved to the output queue
+    char buf_[4096];
+};
+
+}  // namespace wheel
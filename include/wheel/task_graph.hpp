@@ -0,0 +1,269 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <wheel/future.hpp>
+
+namespace wheel {
+
+// static DAG of callables, build once and run many times on a ThreadPool
+// a node is posted as soon as its last predecessor finished, no worker ever waits on another node
+//
+//     TaskGraph graph;
+//     auto load = graph.emplace("load", [] { ... });
+//     auto parse = graph.emplace("parse", [] { ... });
+//     graph.precede(load, parse);
+//     graph.run(pool).get();
+//     std::cout << graph.report();
+class TaskGraph {
+public:
+    using Node = size_t;
+
+    // nanoseconds since the start of the run
+    struct Timing {
+        int64_t start = 0;
+        int64_t end = 0;
+    };
+
+    TaskGraph() = default;
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+
+    Node emplace(std::string name, std::function<void()> fn) {
+        auto& node = nodes_.emplace_back();
+        node.name = std::move(name);
+        node.fn = std::move(fn);
+        validated_ = false;
+        return nodes_.size() - 1;
+    }
+
+    // after starts once before finished
+    void precede(Node before, Node after) {
+        nodes_[before].successors.push_back(after);
+        nodes_[after].predecessors.push_back(before);
+        validated_ = false;
+    }
+
+    size_t size() const { return nodes_.size(); }
+    const std::string& name(Node node) const { return nodes_[node].name; }
+
+    // one run at a time, the graph must stay alive and unchanged until the future is ready
+    // after a node throws, nodes that did not start yet are skipped and the future rethrows the first exception
+    template <typename Pool>
+    Future<void> run(Pool& pool) {
+        if (running_.exchange(true, std::memory_order_acquire)) {
+            throw std::logic_error("TaskGraph: already running");
+        }
+        if (!validated_) {
+            validate_();
+        }
+        promise_ = Promise<void>();
+        auto future = promise_.get_future();
+        error_ = nullptr;
+        failed_.store(false, std::memory_order_relaxed);
+        start_ = std::chrono::steady_clock::now();
+        if (nodes_.empty()) {
+            finish_();
+            return future;
+        }
+
+        remaining_.store(nodes_.size(), std::memory_order_relaxed);
+        for (auto& node : nodes_) {
+            node.pending.store(node.predecessors.size(), std::memory_order_relaxed);
+        }
+        // the last root may finish the whole run before post() returns, nodes_ is not read after the first post
+        std::vector<Node> roots;
+        for (Node i = 0; i < nodes_.size(); ++i) {
+            if (nodes_[i].predecessors.empty()) {
+                roots.push_back(i);
+            }
+        }
+        for (Node i : roots) {
+            pool.post([this, &pool, i] { execute_(pool, i); });
+        }
+        return future;
+    }
+
+    // the calling thread runs queued tasks while waiting
+    template <typename Pool>
+    void run_and_wait(Pool& pool) {
+        auto future = run(pool);
+        while (!future.ready()) {
+            if (!pool.run_pending_task()) {
+                std::this_thread::yield();
+            }
+        }
+        future.get();
+    }
+
+    // of the last finished run
+    const Timing& timing(Node node) const { return nodes_[node].timing; }
+
+    int64_t makespan() const {
+        int64_t end = 0;
+        for (auto& node : nodes_) {
+            end = std::max(end, node.timing.end);
+        }
+        return end;
+    }
+
+    // the chain that decided when the last run finished: from the last node to finish,
+    // go back through the predecessor that finished last, returned in run order
+    std::vector<Node> critical_path() const {
+        std::vector<Node> path;
+        if (nodes_.empty()) {
+            return path;
+        }
+        auto later = [this](Node a, Node b) { return nodes_[a].timing.end < nodes_[b].timing.end; };
+        std::vector<Node> all(nodes_.size());
+        for (Node i = 0; i < all.size(); ++i) {
+            all[i] = i;
+        }
+        Node node = *std::max_element(all.begin(), all.end(), later);
+        while (true) {
+            path.push_back(node);
+            auto& predecessors = nodes_[node].predecessors;
+            if (predecessors.empty()) {
+                break;
+            }
+            node = *std::max_element(predecessors.begin(), predecessors.end(), later);
+        }
+        std::reverse(path.begin(), path.end());
+        return path;
+    }
+
+    // critical path of the last run, one line per node with its run time and the wait before it
+    std::string report() const {
+        std::ostringstream out;
+        out << "critical path, total " << makespan() / 1000 << " us\n";
+        int64_t previous_end = 0;
+        for (Node node : critical_path()) {
+            auto& timing = nodes_[node].timing;
+            out << "  " << nodes_[node].name << ": run " << (timing.end - timing.start) / 1000
+                << " us, waited " << (timing.start - previous_end) / 1000 << " us\n";
+            previous_end = timing.end;
+        }
+        return out.str();
+    }
+
+private:
+    struct NodeData {
+        std::string name;
+        std::function<void()> fn;
+        std::vector<Node> successors;
+        std::vector<Node> predecessors;
+        std::atomic<size_t> pending = 0;  // predecessors not finished in this run
+        Timing timing;  // written by the thread that runs the node
+    };
+
+    int64_t now_() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_).count();
+    }
+
+    // Kahn's algorithm, every node must be reached
+    void validate_() {
+        std::vector<size_t> pending(nodes_.size());
+        std::vector<Node> ready;
+        for (Node i = 0; i < nodes_.size(); ++i) {
+            pending[i] = nodes_[i].predecessors.size();
+            if (pending[i] == 0) {
+                ready.push_back(i);
+            }
+        }
+        size_t visited = 0;
+        while (!ready.empty()) {
+            Node node = ready.back();
+            ready.pop_back();
+            ++visited;
+            for (Node next : nodes_[node].successors) {
+                if (--pending[next] == 0) {
+                    ready.push_back(next);
+                }
+            }
+        }
+        if (visited != nodes_.size()) {
+            running_.store(false, std::memory_order_release);
+            throw std::logic_error("TaskGraph: cycle");
+        }
+        validated_ = true;
+    }
+
+    // runs the node, posts all successors it made ready but one, and continues with that one here
+    template <typename Pool>
+    void execute_(Pool& pool, Node index) {
+        while (true) {
+            auto& node = nodes_[index];
+            node.timing.start = now_();
+            if (!failed_.load(std::memory_order_relaxed)) {
+                try {
+                    node.fn();
+                } catch (...) {
+                    std::lock_guard<std::mutex> lock(error_mutex_);
+                    if (!error_) {
+                        error_ = std::current_exception();
+                    }
+                    failed_.store(true, std::memory_order_relaxed);
+                }
+            }
+            node.timing.end = now_();
+
+            Node next = nodes_.size();
+            for (Node successor : node.successors) {
+                if (nodes_[successor].pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    if (next != nodes_.size()) {
+                        pool.post([this, &pool, next] { execute_(pool, next); });
+                    }
+                    next = successor;
+                }
+            }
+            // once remaining_ is counted down another thread may finish the run and the graph be destroyed
+            bool has_next = next != nodes_.size();
+            if (remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                finish_();
+                return;
+            }
+            if (!has_next) {
+                return;
+            }
+            index = next;
+        }
+    }
+
+    // the graph may be destroyed as soon as the promise is set
+    void finish_() {
+        auto promise = std::move(promise_);
+        auto error = error_;
+        running_.store(false, std::memory_order_release);
+        if (error) {
+            promise.set_exception(std::move(error));
+        } else {
+            promise.set_value();
+        }
+    }
+
+    std::deque<NodeData> nodes_;  // stable addresses, NodeData is not movable
+    bool validated_ = false;
+
+    // state of the current run
+    std::atomic<bool> running_ = false;
+    std::atomic<size_t> remaining_ = 0;
+    std::atomic<bool> failed_ = false;
+    std::exception_ptr error_;
+    std::mutex error_mutex_;
+    Promise<void> promise_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace wheel
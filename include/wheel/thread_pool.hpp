@@ -1,46 +1,284 @@
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <coroutine>
+#include <cstdint>
 #include <functional>
 #include <future>
+#include <memory>
 #include <mutex>
 #include <thread>
 #include <vector>
 
+#include <wheel/affinity.hpp>
+#include <wheel/future.hpp>
+#include <wheel/histogram.hpp>
+#include <wheel/job.hpp>
+#include <wheel/mpmc_queue.hpp>
 #include <wheel/safe_queue.hpp>
+#include <wheel/work_stealing_deque.hpp>
+
+// 0 compiles every ThreadPool counter, histogram and the timestamps they need out of the hot path
+#ifndef WHEEL_THREAD_POOL_STATS
+#define WHEEL_THREAD_POOL_STATS 1
+#endif
 
 namespace wheel {
 
-class ThreadPool {
+enum class ThreadPoolMode : uint8_t {
+    GLOBAL_QUEUE,  // every task goes through one shared queue
+    WORK_STEALING,  // tasks submitted by a worker stay in its own deque, idle workers steal
+};
+
+// tasks of a higher class run first, lower classes still get a share(see get_task_)
+enum class Priority : uint8_t {
+    LATENCY,  // short tasks on the request path, e.g. socket handling
+    NORMAL,
+    BACKGROUND,  // never occupies every worker, so LATENCY tasks always find one soon
+};
+
+inline constexpr int NUM_PRIORITIES = 3;
+
+// what happens to a task that is still queued when its deadline passed
+enum class DeadlinePolicy : uint8_t {
+    DROP,  // destroyed without running, a future gets std::future_errc::broken_promise
+    DEMOTE,  // moved to BACKGROUND, and runs without deadline
+};
+
+struct TaskOptions {
+    Priority priority = Priority::NORMAL;
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();  // max means none
+    DeadlinePolicy on_deadline = DeadlinePolicy::DROP;
+};
+
+// the pool grows and shrinks between min_threads and max_threads
+// the defaults keep a fixed size pool whose idle workers park at once
+struct ElasticPolicy {
+    int min_threads = 0;  // idle workers never retire below this
+    int max_threads = 0;  // grow up to this when tasks queue up, 0 means never grow
+    int grow_queue_depth = 4;  // queued tasks beyond the idle workers that trigger growth
+    std::chrono::milliseconds idle_timeout{0};  // retire a worker parked this long, 0 means never
+    std::chrono::microseconds spin{0};  // busy wait for a task before parking, saves the futex round trip
+};
+
+// per class, summed over all workers
+// the histograms only hold the sampled tasks, see set_stats_sample_period
+struct PriorityStats {
+    Histogram queue_wait;  // nanoseconds from push to start of run
+    Histogram run_time;  // nanoseconds
+    uint64_t executed = 0;
+    uint64_t dropped = 0;
+    uint64_t demoted = 0;
+};
+
+struct WorkerStats {
+    int index = 0;
+    bool alive = false;  // false once retired
+    uint64_t executed = 0;
+    uint64_t steals = 0;  // tasks taken from other workers' deques
+    uint64_t parks = 0;  // futex waits
+    uint64_t wakeups = 0;  // parks ended by a notify instead of a timeout
+    int64_t idle_ns = 0;  // spinning and parked
+    int64_t deque_size = 0;
+};
+
+// snapshot of the whole pool, see BasicThreadPool::snapshot
+struct ThreadPoolStats {
+    int threads = 0;
+    std::array<PriorityStats, NUM_PRIORITIES> priorities;  // index is Priority
+    std::array<int64_t, NUM_PRIORITIES> queue_depth{};  // shared queues only
+    std::vector<WorkerStats> workers;  // every slot ever used
+    uint64_t grows = 0;
+    uint64_t retires = 0;
+};
+
+// Queue<T> is the shared queue(one per Priority), it needs try_push(T&&), try_pop(T&) and empty()
+// e.g. SafeQueue(mutex, unbounded) or MPMCQueue(lock free, bounded)
+template <template <typename> typename Queue = SafeQueue>
+class BasicThreadPool {
 public:
-    ThreadPool() = default;
-    explicit ThreadPool(int num);
-    ~ThreadPool();
+    using Mode = ThreadPoolMode;
+
+    static constexpr int MAX_THREADS = 256;
 
-    ThreadPool(const ThreadPool&) = delete;
-    ThreadPool& operator=(const ThreadPool&) = delete;
-    ThreadPool(ThreadPool&&) = delete;
-    ThreadPool& operator=(ThreadPool&&) = delete;
+    explicit BasicThreadPool(int num = 0, Mode mode = Mode::GLOBAL_QUEUE, PlacementPolicy placement = {});
+    ~BasicThreadPool();
 
+    BasicThreadPool(const BasicThreadPool&) = delete;
+    BasicThreadPool& operator=(const BasicThreadPool&) = delete;
+    BasicThreadPool(BasicThreadPool&&) = delete;
+    BasicThreadPool& operator=(BasicThreadPool&&) = delete;
+
+    // start num more threads, MAX_THREADS at most are alive at the same time
     void add_thread(int num = 1);
+    // placement of threads added after this call, not thread safe with add_thread
+    void set_placement(PlacementPolicy placement) { placement_ = std::move(placement); }
+    // also starts threads up to min_threads
+    void set_elastic(const ElasticPolicy& policy);
+    // threads alive now
+    int size() const { return threads_.load(std::memory_order_acquire); }
+    Mode mode() const { return mode_; }
 
-    template<typename F, typename ...Args>
+    // run one queued task on the calling thread(to help instead of blocking), false if there was none
+    bool run_pending_task();
+    // index of the worker running the calling thread in [0, MAX_THREADS), -1 for other threads
+    // usually below size(), but a worker may keep a higher index after others retired
+    int current_worker_index() const;
+
+    template<typename F, typename ...Args> requires (!std::is_same_v<std::decay_t<F>, TaskOptions>)
     auto submit(F&& f, Args&& ...args) -> std::future<decltype(f(args...))> {
+        return submit(TaskOptions{}, std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
+    template<typename F, typename ...Args>
+    auto submit(const TaskOptions& options, F&& f, Args&& ...args) -> std::future<decltype(f(args...))> {
         auto func = std::bind(std::forward<F>(f), std::forward<Args>(args)...);
-        auto task_ptr = std::make_shared<std::packaged_task<decltype(f(args...))()>>(func);
-        task_queue_.push([task_ptr] { (*task_ptr)(); });
-        cv_.notify_one();
+        std::packaged_task<decltype(f(args...))()> task(std::move(func));
+        auto future = task.get_future();
+        push_(options, [task = std::move(task)]() mutable { task(); });
 
-        return task_ptr->get_future();
+        return future;
     }
 
+    // like submit, but with wheel::Future, usually no allocation at all
+    template<typename F, typename ...Args> requires (!std::is_same_v<std::decay_t<F>, TaskOptions>)
+    auto async(F&& f, Args&& ...args) -> Future<std::invoke_result_t<F, Args...>> {
+        return async(TaskOptions{}, std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
+    template<typename F, typename ...Args>
+    auto async(const TaskOptions& options, F&& f, Args&& ...args) -> Future<std::invoke_result_t<F, Args...>> {
+        using R = std::invoke_result_t<F, Args...>;
+        Promise<R> promise;
+        auto future = promise.get_future();
+        push_(options, [promise = std::move(promise), f = std::forward<F>(f), ...args = std::forward<Args>(args)]() mutable {
+            try {
+                if constexpr (std::is_void_v<R>) {
+                    std::invoke(f, args...);
+                    promise.set_value();
+                } else {
+                    promise.set_value(std::invoke(f, args...));
+                }
+            } catch (...) {
+                promise.set_exception(std::current_exception());
+            }
+        });
+
+        return future;
+    }
+
+    // fire and forget, f must not throw
+    template<typename F, typename ...Args> requires (!std::is_same_v<std::decay_t<F>, TaskOptions>)
+    void post(F&& f, Args&& ...args) {
+        post(TaskOptions{}, std::forward<F>(f), std::forward<Args>(args)...);
+    }
+
+    template<typename F, typename ...Args>
+    void post(const TaskOptions& options, F&& f, Args&& ...args) {
+        if constexpr (sizeof...(Args) == 0) {
+            push_(options, Job(std::forward<F>(f)));
+        } else {
+            push_(options, [f = std::forward<F>(f), ...args = std::forward<Args>(args)]() mutable { std::invoke(f, args...); });
+        }
+    }
+
+    // co_await pool.schedule() resumes the coroutine on a worker
+    auto schedule(Priority priority = Priority::NORMAL) {
+        struct Awaiter {
+            BasicThreadPool& pool;
+            Priority priority;
+
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> handle) {
+                pool.post({.priority = priority}, [handle] { handle.resume(); });
+            }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{*this, priority};
+    }
+
+    // safe to call while tasks run, all zero when WHEEL_THREAD_POOL_STATS is 0
+    // counters are exact, time is measured for one in period tasks(0 never, 1 every task)
+    // reading the clock costs far more than the counters, hence the sampling
+    PriorityStats stats(Priority priority) const;
+    ThreadPoolStats snapshot() const;
+    void set_stats_sample_period(uint32_t period) { sample_period_.store(period, std::memory_order_relaxed); }
+
 private:
+    struct Task {
+        Job job;
+        int64_t enqueue_time = 0;  // steady clock nanoseconds, 0 if its time is not sampled
+        int64_t deadline = 0;  // 0 means none
+        Priority priority = Priority::NORMAL;
+        DeadlinePolicy on_deadline = DeadlinePolicy::DROP;
+    };
+
+    // shared queue of one class
+    struct Lane {
+        Queue<Task> queue;
+        SafeQueue<Task> overflow;  // only used when a bounded queue is full
+        std::atomic<int> overflow_size = 0;
+    };
+
+    struct Counters;
+    struct Worker;
+
+    int free_slot_();
+    void start_worker_(int index);
+    void grow_();
+    void push_(const TaskOptions& options, Job&& job);
+    void push_(Task&& task);
+    void run_(Worker& worker);
+    void execute_(Worker* worker, Task& task);
+    bool get_task_(Worker* worker, Task& task);
+    bool pop_(Worker* worker, Priority priority, Task& task);
+    bool steal_(Worker* worker, Task& task);
+    bool has_task_();
+    int background_limit_() const;
+    bool spin_();
+    bool park_(Worker& worker);
+    void notify_();
+
+    Mode mode_;
+    PlacementPolicy placement_;
     std::atomic<bool> stop_ = false;
-    SafeQueue<std::function<void()>> task_queue_;
-    std::vector<std::thread> threads_;
+    std::array<Lane, NUM_PRIORITIES> lanes_;
+    std::atomic<int> running_background_ = 0;
+    std::vector<std::unique_ptr<Worker>> workers_;  // fixed MAX_THREADS slots, thieves index it concurrently
+    std::atomic<int> num_slots_ = 0;  // slots ever used, retired workers keep theirs for reuse
+    std::atomic<int> threads_ = 0;
+    std::mutex grow_mutex_;  // starting threads
+
+    // elastic sizing
+    std::atomic<int> max_threads_ = 0;
+    std::atomic<int> grow_queue_depth_ = 4;
+    std::atomic<int64_t> spin_ns_ = 0;
+    std::atomic<int> spinning_ = 0;
+    int min_threads_ = 0;  // guarded by mutex_
+    std::chrono::milliseconds idle_timeout_{0};  // guarded by mutex_
+
+    // stats of threads outside the pool that run tasks through run_pending_task
+    std::unique_ptr<Counters> helper_counters_;
+    mutable std::mutex helper_mutex_;
+    std::atomic<uint32_t> sample_period_ = 16;
+    std::atomic<uint64_t> grows_ = 0;
+    std::atomic<uint64_t> retires_ = 0;
+
+    // parking
+    std::atomic<int> sleepers_ = 0;
+    int wakeups_ = 0;  // guarded by mutex_
     std::condition_variable cv_;
     std::mutex mutex_;
 };
 
+// defined in thread_pool.cpp
+extern template class BasicThreadPool<SafeQueue>;
+extern template class BasicThreadPool<MPMCQueue>;
+
+using ThreadPool = BasicThreadPool<SafeQueue>;
+using LockFreeThreadPool = BasicThreadPool<MPMCQueue>;
+
 }  // namespace wheel
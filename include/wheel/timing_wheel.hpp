@@ -0,0 +1,67 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace wheel {
+
+// hashed timing wheel of deadlines keyed by small ints(fds), used by one thread
+// a deadline lives in the slot of its tick, one revolution is slots * tick, later ones wait for their round
+// reset() is O(1) and usually just a store: a later deadline leaves the entry in its slot,
+// it is moved when that slot comes up, so touching a connection on every packet stays cheap
+class TimingWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // slots must be a power of 2
+    explicit TimingWheel(std::chrono::milliseconds tick = std::chrono::milliseconds(100), size_t slots = 512,
+                         Clock::time_point start = Clock::now());
+
+    // (re)arm id to expire timeout after now, rounded up to the tick
+    void reset(int id, std::chrono::milliseconds timeout, Clock::time_point now = Clock::now());
+    bool remove(int id);
+    bool contains(int id) const { return id >= 0 && static_cast<size_t>(id) < entries_.size() && entries_[id].linked; }
+
+    // f(id) for every id whose deadline passed, removed before the call so f may reset it
+    // returns how many expired
+    template <typename F>
+    size_t expire(Clock::time_point now, F&& f) {
+        collect_(now);
+        for (int id : expired_) {
+            f(id);
+        }
+        return expired_.size();
+    }
+
+    // until the next tick that may expire something(epoll_wait timeout), -1 if nothing is armed
+    int next_timeout_ms(Clock::time_point now = Clock::now()) const;
+
+    size_t size() const { return size_; }
+    std::chrono::milliseconds tick() const { return tick_; }
+
+private:
+    struct Entry {
+        int prev = -1;
+        int next = -1;
+        uint64_t tick = 0;  // of the slot it is in
+        uint64_t deadline = 0;  // may be later than tick, never earlier
+        bool linked = false;
+    };
+
+    uint64_t ticks_(Clock::time_point t) const;
+    void link_(int id, uint64_t tick);
+    void unlink_(int id);
+    void collect_(Clock::time_point now);
+
+    std::chrono::milliseconds tick_;
+    Clock::time_point start_;
+    uint64_t current_ = 0;  // next tick to expire, the ones before are done
+    std::vector<int> slots_;  // list heads
+    std::vector<Entry> entries_;  // by id
+    std::vector<int> expired_;
+    size_t size_ = 0;
+};
+
+}  // namespace wheel
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+namespace wheel {
+
+// Chase-Lev work stealing deque
+// owner thread: push() / pop() at the bottom
+// other threads: steal() at the top
+// T must be trivially copyable(usually a pointer), a thief may read a slot that is being overwritten
+template <typename T>
+class WorkStealingDeque {
+    static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+
+public:
+    explicit WorkStealingDeque(int64_t capacity = 256) {
+        int64_t cap = 1;
+        while (cap < capacity) {
+            cap <<= 1;
+        }
+        array_.store(new Array(cap), std::memory_order_relaxed);
+    }
+
+    ~WorkStealingDeque() {
+        delete array_.load(std::memory_order_relaxed);
+        for (auto* array : garbage_) {
+            delete array;
+        }
+    }
+
+    WorkStealingDeque(const WorkStealingDeque&) = delete;
+    WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+    // may be stale when called by a thief
+    int64_t size() const {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_relaxed);
+        return b > t ? b - t : 0;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    // owner only
+    void push(T value) {
+        int64_t b = bottom_.load(std::memory_order_relaxed);
+        int64_t t = top_.load(std::memory_order_acquire);
+        Array* array = array_.load(std::memory_order_relaxed);
+        if (b - t > array->capacity - 1) {
+            array = grow_(array, b, t);
+        }
+        array->put(b, value);
+        bottom_.store(b + 1, std::memory_order_release);
+    }
+
+    // owner only
+    std::optional<T> pop() {
+        int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+        Array* array = array_.load(std::memory_order_relaxed);
+        bottom_.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top_.load(std::memory_order_relaxed);
+
+        if (t > b) {  // empty
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+        T value = array->get(b);
+        if (t == b) {  // last one, race with thieves
+            bool won = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom_.store(b + 1, std::memory_order_relaxed);
+            if (!won) {
+                return std::nullopt;
+            }
+        }
+        return value;
+    }
+
+    // any thread
+    std::optional<T> steal() {
+        int64_t t = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom_.load(std::memory_order_acquire);
+        if (t >= b) {
+            return std::nullopt;
+        }
+        Array* array = array_.load(std::memory_order_acquire);
+        T value = array->get(t);
+        if (!top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return std::nullopt;
+        }
+        return value;
+    }
+
+private:
+    struct Array {
+        explicit Array(int64_t capacity) : capacity(capacity), mask(capacity - 1), data(new std::atomic<T>[capacity]) {}
+        ~Array() { delete[] data; }
+
+        void put(int64_t i, T value) { data[i & mask].store(value, std::memory_order_relaxed); }
+        T get(int64_t i) const { return data[i & mask].load(std::memory_order_relaxed); }
+
+        int64_t capacity;
+        int64_t mask;
+        std::atomic<T>* data;
+    };
+
+    // thieves may still read the old array, so it is kept until destruction
+    Array* grow_(Array* array, int64_t b, int64_t t) {
+        auto* bigger = new Array(array->capacity * 2);
+        for (int64_t i = t; i < b; ++i) {
+            bigger->put(i, array->get(i));
+        }
+        garbage_.push_back(array);
+        array_.store(bigger, std::memory_order_release);
+        return bigger;
+    }
+
+    alignas(64) std::atomic<int64_t> top_ = 0;
+    alignas(64) std::atomic<int64_t> bottom_ = 0;
+    alignas(64) std::atomic<Array*> array_;
+    std::vector<Array*> garbage_;  // owner only
+};
+
+}  // namespace wheel
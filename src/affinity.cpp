@@ -0,0 +1,166 @@
+#include <wheel/affinity.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+
+namespace wheel {
+
+std::vector<int> parse_cpu_list(std::string_view list) {
+    std::vector<int> cpus;
+    while (!list.empty()) {
+        auto comma = list.find(',');
+        auto range = list.substr(0, comma);
+        list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+
+        int first = 0, last = 0;
+        auto [p, ec] = std::from_chars(range.data(), range.data() + range.size(), first);
+        if (ec != std::errc()) {
+            continue;
+        }
+        last = first;
+        if (p != range.data() + range.size() && *p == '-') {
+            std::from_chars(p + 1, range.data() + range.size(), last);
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+namespace {
+
+std::vector<int> allowed_cpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof set, &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+
+std::vector<std::vector<int>> read_numa_nodes() {
+    auto allowed = allowed_cpus();
+    std::vector<std::vector<int>> nodes;
+    for (int node = 0;; ++node) {
+        std::ifstream file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        if (!file) {
+            break;  // node ids of online nodes are dense in practice
+        }
+        std::string list;
+        std::getline(file, list);
+        std::vector<int> cpus;
+        for (int cpu : parse_cpu_list(list)) {
+            if (std::binary_search(allowed.begin(), allowed.end(), cpu)) {
+                cpus.push_back(cpu);
+            }
+        }
+        nodes.push_back(std::move(cpus));
+    }
+    if (nodes.empty()) {
+        nodes.push_back(std::move(allowed));
+    }
+    return nodes;
+}
+
+}  // namespace
+
+const std::vector<std::vector<int>>& numa_nodes() {
+    static const std::vector<std::vector<int>> nodes = read_numa_nodes();
+    return nodes;
+}
+
+int numa_node_of(int cpu) {
+    auto& nodes = numa_nodes();
+    for (size_t node = 0; node < nodes.size(); ++node) {
+        if (std::find(nodes[node].begin(), nodes[node].end(), cpu) != nodes[node].end()) {
+            return static_cast<int>(node);
+        }
+    }
+    return -1;
+}
+
+int current_cpu() {
+    return sched_getcpu();
+}
+
+bool set_thread_affinity(const std::vector<int>& cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof set, &set) == 0;
+}
+
+bool set_thread_name(std::string_view name) {
+    std::string s(name.substr(0, 15));
+    return pthread_setname_np(pthread_self(), s.c_str()) == 0;
+}
+
+std::vector<int> PlacementPolicy::cpus_for(int index, const std::vector<std::vector<int>>& nodes) const {
+    if (placement == Placement::NONE) {
+        return {};
+    }
+
+    // allowed cpus of every node, empty nodes removed
+    std::vector<std::vector<int>> allowed;
+    for (auto& node : nodes) {
+        std::vector<int> node_cpus;
+        std::copy_if(node.begin(), node.end(), std::back_inserter(node_cpus), [this](int cpu) {
+            return cpus.empty() || std::find(cpus.begin(), cpus.end(), cpu) != cpus.end();
+        });
+        allowed.push_back(std::move(node_cpus));
+    }
+
+    std::vector<int> order;
+    if (placement == Placement::SPREAD) {
+        for (size_t i = 0;; ++i) {
+            bool any = false;
+            for (auto& node : allowed) {
+                if (i < node.size()) {
+                    order.push_back(node[i]);
+                    any = true;
+                }
+            }
+            if (!any) {
+                break;
+            }
+        }
+    } else if (placement == Placement::CPU_SET && node >= 0) {
+        if (node < static_cast<int>(allowed.size())) {
+            order = allowed[node];
+        }
+    } else {
+        // the start node first
+        int start = node;
+        if (start < 0 || start >= static_cast<int>(allowed.size()) || allowed[start].empty()) {
+            start = 0;
+            while (start < static_cast<int>(allowed.size()) && allowed[start].empty()) {
+                ++start;
+            }
+        }
+        for (size_t i = 0; i < allowed.size(); ++i) {
+            auto& node_cpus = allowed[(start + i) % allowed.size()];
+            order.insert(order.end(), node_cpus.begin(), node_cpus.end());
+        }
+    }
+
+    if (order.empty()) {
+        return {};
+    }
+    if (placement == Placement::CPU_SET) {
+        return order;
+    }
+    return {order[index % order.size()]};
+}
+
+}  // namespace wheel
@@ -0,0 +1,323 @@
+#include <wheel/connection_pool.hpp>
+#include <wheel/log.hpp>
+
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace wheel {
+
+namespace {
+
+thread_local ConnectionPool* local_pool = nullptr;
+
+int domain_of(const Endpoint& endpoint) {
+    if (endpoint.port == 0) {
+        return AF_UNIX;
+    }
+    return endpoint.address.find(':') != std::string::npos ? AF_INET6 : AF_INET;
+}
+
+}  // namespace
+
+ConnectionPool::ConnectionPool(Epoll& epoll, PoolOptions options) : epoll_(epoll), options_(options) {}
+
+ConnectionPool::~ConnectionPool() {
+    for (auto& handler : handlers_) {
+        if (handler) {
+            epoll_.del(handler->socket().fd());
+        }
+    }
+}
+
+ConnectionPool* ConnectionPool::local() {
+    return local_pool;
+}
+
+void ConnectionPool::set_local(ConnectionPool* pool) {
+    local_pool = pool;
+}
+
+size_t ConnectionPool::idle(const Endpoint& endpoint) const {
+    auto it = keys_.find(endpoint.key());
+    return it == keys_.end() ? 0 : it->second.idle.size();
+}
+
+uint64_t ConnectionPool::acquire_(const Endpoint& endpoint, Factory factory, Callback done) {
+    auto [it, inserted] = keys_.try_emplace(endpoint.key());
+    auto& key = it->second;
+    if (inserted) {
+        key.endpoint = endpoint;
+    }
+    uint64_t ticket = ++next_ticket_;
+    while (!key.idle.empty()) {
+        UpstreamHandler* handler = options_.lifo ? key.idle.back() : key.idle.front();
+        options_.lifo ? key.idle.pop_back() : key.idle.pop_front();
+        if (options_.health_check && !healthy_(handler)) {
+            close_(handler);
+            continue;
+        }
+        handler->state_ = UpstreamHandler::State::IN_USE;
+        ++handler->uses_;
+        done(handler);
+        return ticket;
+    }
+    pending_.emplace(ticket, std::move(done));
+    if (options_.max_connections > 0 && key.total >= options_.max_connections) {
+        key.waiters.push_back({ticket, std::move(factory)});
+        return ticket;
+    }
+    connect_(key, ticket, factory);
+    return ticket;
+}
+
+bool ConnectionPool::cancel(uint64_t ticket) {
+    return pending_.erase(ticket) > 0;
+}
+
+// registered for EPOLLOUT until the connect completed, level triggered like the MULTI_REACTOR connections
+void ConnectionPool::connect_(Key& key, uint64_t ticket, Factory& factory) {
+    auto& endpoint = key.endpoint;
+    auto handler = factory();
+    Socket socket;
+    bool ok = socket.init(SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, domain_of(endpoint));
+    if (ok) {
+        ok = endpoint.port == 0 ? socket.connect_unix(endpoint.address) : socket.connect(endpoint.address, endpoint.port);
+        ok = ok || errno == EINPROGRESS;
+    }
+    int fd = socket.fd();
+    if (!ok || !epoll_.add(fd, EPOLLOUT, handler.get())) {
+        Log::error("upstream {} connect error: {}(errno: {})", endpoint.key(), std::strerror(errno), errno);
+        finish_(ticket, nullptr);
+        return;
+    }
+    handler->set_socket(std::move(socket));
+    handler->key_ = endpoint.key();
+    handler->ticket_ = ticket;
+    handler->since_ = Clock::now();
+    if (static_cast<size_t>(fd) >= handlers_.size()) {
+        handlers_.resize(std::max<size_t>(fd + 1, handlers_.size() * 2));
+    }
+    connecting_.push_back(handler.get());
+    handlers_[fd] = std::move(handler);
+    ++key.total;
+    ++size_;
+    if (options_.connect_timeout.count() > 0) {
+        schedule_(handlers_[fd]->since_ + options_.connect_timeout);
+    }
+}
+
+void ConnectionPool::connected_(UpstreamHandler* handler) {
+    std::erase(connecting_, handler);
+    handler->state_ = UpstreamHandler::State::IN_USE;
+    handler->uses_ = 1;
+    handler->set_write_armed(false);
+    epoll_.mod(handler->socket().fd(), EPOLLIN, handler);
+    finish_(handler->ticket_, handler);
+}
+
+void ConnectionPool::finish_(uint64_t ticket, UpstreamHandler* handler) {
+    auto it = pending_.find(ticket);
+    if (it == pending_.end()) {
+        if (handler) {
+            release(handler);
+        }
+        return;
+    }
+    auto done = std::move(it->second);
+    pending_.erase(it);
+    done(handler);
+}
+
+void ConnectionPool::release(UpstreamHandler* handler, bool reusable) {
+    if (handler->state_ != UpstreamHandler::State::IN_USE) {
+        return;
+    }
+    auto& key = keys_[handler->key_];
+    bool worn = options_.max_uses > 0 && handler->uses_ >= options_.max_uses;
+    if (!reusable || worn || handler->pending_output() > 0) {
+        close_(handler);
+        serve_waiters_(key);
+        return;
+    }
+    while (!key.waiters.empty()) {
+        auto waiter = std::move(key.waiters.front());
+        key.waiters.pop_front();
+        if (pending_.contains(waiter.ticket)) {
+            ++handler->uses_;
+            finish_(waiter.ticket, handler);
+            return;
+        }
+    }
+    if (key.idle.size() >= options_.max_idle) {
+        close_(handler);
+        return;
+    }
+    handler->state_ = UpstreamHandler::State::IDLE;
+    handler->since_ = Clock::now();
+    key.idle.push_back(handler);
+    if (options_.idle_timeout.count() > 0) {
+        schedule_(handler->since_ + options_.idle_timeout);
+    }
+}
+
+bool ConnectionPool::flush(UpstreamHandler* handler) {
+    if (!handler->flush()) {
+        handler->on_close();
+        close_(handler);
+        serve_waiters_(keys_[handler->key_]);
+        return false;
+    }
+    update_events_(handler);
+    return true;
+}
+
+void ConnectionPool::handle(UpstreamHandler* handler, uint32_t events) {
+    using State = UpstreamHandler::State;
+    switch (handler->state_) {
+        case State::CLOSED:  // earlier in this batch
+            return;
+        case State::CONNECTING: {
+            int error = handler->socket().error();
+            if (error == 0 && !(events & EPOLLHUP)) {
+                connected_(handler);
+                return;
+            }
+            Log::error("upstream {} connect error: {}", handler->key_, std::strerror(error));
+            uint64_t ticket = handler->ticket_;
+            auto& key = keys_[handler->key_];
+            close_(handler);
+            finish_(ticket, nullptr);
+            serve_waiters_(key);
+            return;
+        }
+        case State::IDLE: {
+            // nothing is expected on an idle connection: the peer closed it, or it is out of step
+            auto& key = keys_[handler->key_];
+            close_(handler);
+            serve_waiters_(key);
+            return;
+        }
+        case State::IN_USE:
+            break;
+    }
+    bool ok = (!(events & EPOLLERR) || handler->on_error())
+        && (!(events & EPOLLOUT) || handler->on_writable())
+        && (!(events & EPOLLIN) || handler->process())
+        && !(events & EPOLLHUP);
+    if (handler->state_ != State::IN_USE) {  // released or closed by process()
+        return;
+    }
+    if (!ok) {
+        handler->on_close();
+        if (handler->state_ != State::CLOSED) {
+            auto& key = keys_[handler->key_];
+            close_(handler);
+            serve_waiters_(key);
+        }
+        return;
+    }
+    flush(handler);
+}
+
+void ConnectionPool::update_events_(UpstreamHandler* handler) {
+    bool write = handler->pending_output() > 0;
+    if (write != handler->write_armed()) {
+        epoll_.mod(handler->socket().fd(), write ? EPOLLIN | EPOLLOUT : EPOLLIN, handler);
+        handler->set_write_armed(write);
+    }
+}
+
+// the handler lives on in closed_ until expire(), a later event of the same batch sees State::CLOSED
+// its socket too: the destructor closes it, after zerocopy sends still in flight(SocketHandler lingers)
+void ConnectionPool::close_(UpstreamHandler* handler) {
+    if (handler->state_ == UpstreamHandler::State::CLOSED) {
+        return;
+    }
+    auto& key = keys_[handler->key_];
+    if (handler->state_ == UpstreamHandler::State::CONNECTING) {
+        std::erase(connecting_, handler);
+    } else if (handler->state_ == UpstreamHandler::State::IDLE) {
+        std::erase(key.idle, handler);
+    }
+    handler->state_ = UpstreamHandler::State::CLOSED;
+    int fd = handler->socket().fd();
+    epoll_.del(fd);
+    --key.total;
+    --size_;
+    closed_.push_back(std::move(handlers_[fd]));
+}
+
+void ConnectionPool::serve_waiters_(Key& key) {
+    while (!key.waiters.empty() && (options_.max_connections == 0 || key.total < options_.max_connections)) {
+        auto waiter = std::move(key.waiters.front());
+        key.waiters.pop_front();
+        if (pending_.contains(waiter.ticket)) {
+            connect_(key, waiter.ticket, waiter.factory);
+        }
+    }
+}
+
+bool ConnectionPool::healthy_(UpstreamHandler* handler) {
+    char c;
+    int n = ::recv(handler->socket().fd(), &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    return n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+void ConnectionPool::schedule_(Clock::time_point deadline) {
+    next_expire_ = std::min(next_expire_, deadline);
+}
+
+void ConnectionPool::expire(Clock::time_point now) {
+    closed_.clear();
+    if (now < next_expire_) {
+        return;
+    }
+    next_expire_ = Clock::time_point::max();
+    if (options_.connect_timeout.count() > 0) {
+        for (size_t i = 0; i < connecting_.size();) {
+            auto* handler = connecting_[i];
+            auto deadline = handler->since_ + options_.connect_timeout;
+            if (deadline > now) {
+                schedule_(deadline);
+                ++i;
+                continue;
+            }
+            Log::error("upstream {} connect timeout", handler->key_);
+            uint64_t ticket = handler->ticket_;
+            auto& key = keys_[handler->key_];
+            close_(handler);  // erases it from connecting_
+            finish_(ticket, nullptr);
+            serve_waiters_(key);
+        }
+    }
+    if (options_.idle_timeout.count() > 0) {
+        for (auto& [name, key] : keys_) {
+            // oldest release at the front
+            while (!key.idle.empty() && key.idle.front()->since_ + options_.idle_timeout <= now) {
+                auto* handler = key.idle.front();
+                key.idle.pop_front();
+                close_(handler);
+            }
+            if (!key.idle.empty()) {
+                schedule_(key.idle.front()->since_ + options_.idle_timeout);
+            }
+        }
+    }
+}
+
+int ConnectionPool::next_timeout_ms(Clock::time_point now) const {
+    if (next_expire_ == Clock::time_point::max()) {
+        return -1;
+    }
+    if (next_expire_ <= now) {
+        return 0;
+    }
+    // rounded up, waking early would find nothing to do
+    auto ms = std::chrono::ceil<std::chrono::milliseconds>(next_expire_ - now).count();
+    return static_cast<int>(std::min<long long>(ms, 1 << 30));
+}
+
+}  // namespace wheel
@@ -0,0 +1,55 @@
+#include <wheel/connection_table.hpp>
+
+namespace wheel {
+
+ConnectionTable::ConnectionTable(size_t block_size, size_t block_align, size_t capacity)
+    : block_size_((block_size + block_align - 1) / block_align * block_align), block_align_(block_align) {
+    slots_.resize(capacity, nullptr);
+    allocate_(capacity);
+}
+
+ConnectionTable::~ConnectionTable() {
+    for (size_t fd = 0; fd < slots_.size(); ++fd) {
+        erase(static_cast<int>(fd));
+    }
+    for (void* chunk : chunks_) {
+        ::operator delete(chunk, std::align_val_t(block_align_));
+    }
+}
+
+bool ConnectionTable::erase(int fd) {
+    SocketHandler* handler = find(fd);
+    if (!handler) {
+        return false;
+    }
+    void* block = dynamic_cast<void*>(handler);  // the most derived object, where it was constructed
+    handler->~SocketHandler();
+    free_.push_back(block);
+    slots_[fd] = nullptr;
+    --size_;
+    return true;
+}
+
+void* ConnectionTable::take_() {
+    if (free_.empty()) {
+        allocate_(CHUNK);
+    }
+    void* block = free_.back();
+    free_.pop_back();
+    return block;
+}
+
+void ConnectionTable::allocate_(size_t count) {
+    if (count == 0) {
+        return;
+    }
+    auto* chunk = static_cast<std::byte*>(::operator new(block_size_ * count, std::align_val_t(block_align_)));
+    chunks_.push_back(chunk);
+    // hand out the lowest address first
+    for (size_t i = count; i-- > 0;) {
+        free_.push_back(chunk + i * block_size_);
+    }
+    blocks_ += count;
+}
+
+}  // namespace wheel
@@ -0,0 +1,187 @@
+#include <wheel/datagram_handler.hpp>
+#include <wheel/log.hpp>
+
+#include <netinet/udp.h>  // UDP_GRO, UDP_SEGMENT
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace wheel {
+
+namespace {
+
+constexpr size_t RECV_CONTROL = CMSG_SPACE(sizeof(int));
+constexpr size_t SEND_CONTROL = CMSG_SPACE(sizeof(uint16_t));
+
+bool same_peer(const sockaddr_in& a, const sockaddr_in& b) {
+    return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+}
+
+}  // namespace
+
+DatagramHandler::DatagramHandler(DatagramOptions options)
+    : options_(options), slot_size_(options.gro ? GRO_BUFFER : options.max_datagram) {
+    options_.batch = std::max(options_.batch, 1u);
+    unsigned batch = options_.batch;
+    pool_.resize(batch * slot_size_);
+    recv_msgs_.resize(batch);
+    recv_iov_.resize(batch);
+    recv_peers_.resize(batch);
+    recv_control_.resize(batch * RECV_CONTROL);
+    for (unsigned i = 0; i < batch; ++i) {
+        recv_iov_[i] = {pool_.data() + i * slot_size_, slot_size_};
+        auto& hdr = recv_msgs_[i].msg_hdr;
+        hdr.msg_name = &recv_peers_[i];
+        hdr.msg_iov = &recv_iov_[i];
+        hdr.msg_iovlen = 1;
+        hdr.msg_control = recv_control_.data() + i * RECV_CONTROL;
+    }
+    send_msgs_.resize(batch);
+    send_iov_.resize(batch);
+    send_control_.resize(batch * SEND_CONTROL);
+    send_end_.resize(batch);
+}
+
+// the options the kernel does not know are left off
+void DatagramHandler::setup_() {
+    ready_ = true;
+    if (options_.gro && !socket_.set_gro()) {
+        Log::info("udp gro unsupported: {}", std::strerror(errno));
+        options_.gro = false;
+    }
+    if (options_.gso && !socket_.set_gso(0)) {
+        Log::info("udp gso unsupported: {}", std::strerror(errno));
+        options_.gso = false;
+    }
+}
+
+bool DatagramHandler::process() {
+    if (!ready_) {
+        setup_();
+    }
+    unsigned batch = options_.batch;
+    while (true) {
+        // the kernel overwrites the lengths
+        for (unsigned i = 0; i < batch; ++i) {
+            auto& hdr = recv_msgs_[i].msg_hdr;
+            hdr.msg_namelen = sizeof(sockaddr_in);
+            hdr.msg_controllen = options_.gro ? RECV_CONTROL : 0;
+        }
+        int n = socket_.recvmmsg(recv_msgs_.data(), batch);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN) {
+                Log::error("udp recvmmsg error: {}", std::strerror(errno));
+            }
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            auto& hdr = recv_msgs_[i].msg_hdr;
+            size_t len = recv_msgs_[i].msg_len;
+            if (hdr.msg_flags & MSG_TRUNC) {
+                Log::error("udp datagram over {} bytes dropped", slot_size_);
+                continue;
+            }
+            // a coalesced buffer is cut back into its datagrams
+            size_t segment = len;
+            if (options_.gro) {
+                for (cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr); cmsg; cmsg = CMSG_NXTHDR(&hdr, cmsg)) {
+                    if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+                        int size;
+                        std::memcpy(&size, CMSG_DATA(cmsg), sizeof size);
+                        segment = size > 0 ? static_cast<size_t>(size) : len;
+                    }
+                }
+            }
+            const char* data = pool_.data() + i * slot_size_;
+            size_t offset = 0;
+            do {
+                size_t size = std::min(segment, len - offset);
+                if (!on_datagram({data + offset, size}, recv_peers_[i])) {
+                    return false;
+                }
+                offset += size;
+            } while (offset < len);
+        }
+        if (static_cast<unsigned>(n) < batch) {  // drained, save the EAGAIN call
+            break;
+        }
+    }
+    return flush_datagrams();
+}
+
+void DatagramHandler::send_to(std::span<const char> data, const sockaddr_in& peer) {
+    queue_.push_back({send_buf_.size(), data.size(), peer});
+    send_buf_.append(data.data(), data.size());
+}
+
+// with gso a run of equal size datagrams to one peer(the last may be shorter) is one message
+bool DatagramHandler::flush_datagrams() {
+    if (!ready_) {
+        setup_();
+    }
+    while (queue_head_ < queue_.size()) {
+        unsigned count = 0;
+        size_t i = queue_head_;
+        while (count < options_.batch && i < queue_.size()) {
+            const auto& first = queue_[i];
+            size_t end = i + 1;
+            size_t bytes = first.size;
+            if (options_.gso) {
+                while (end < queue_.size() && end - i < GSO_MAX_SEGMENTS && queue_[end - 1].size == first.size
+                        && queue_[end].size <= first.size && same_peer(queue_[end].peer, first.peer)
+                        && bytes + queue_[end].size <= GSO_MAX_BYTES) {
+                    bytes += queue_[end++].size;
+                }
+            }
+            send_iov_[count] = {send_buf_.data() + first.offset, bytes};
+            auto& hdr = send_msgs_[count].msg_hdr;
+            hdr = {};
+            hdr.msg_name = const_cast<sockaddr_in*>(&first.peer);
+            hdr.msg_namelen = sizeof(sockaddr_in);
+            hdr.msg_iov = &send_iov_[count];
+            hdr.msg_iovlen = 1;
+            if (end - i > 1) {
+                hdr.msg_control = send_control_.data() + count * SEND_CONTROL;
+                hdr.msg_controllen = SEND_CONTROL;
+                cmsghdr* cmsg = CMSG_FIRSTHDR(&hdr);
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                auto segment = static_cast<uint16_t>(first.size);
+                std::memcpy(CMSG_DATA(cmsg), &segment, sizeof segment);
+            }
+            send_end_[count++] = end;
+            i = end;
+        }
+        int n = socket_.sendmmsg(send_msgs_.data(), count);
+        if (n == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == ENOBUFS) {
+                return true;
+            }
+            int err = errno;
+            Log::error("udp sendmmsg error: {}", std::strerror(err));
+            if (err == EBADF || err == ENOTSOCK) {
+                return false;
+            }
+            // the first datagram is at fault(too large, unreachable peer...), not the socket
+            queue_head_ = send_end_[0];
+            continue;
+        }
+        if (n == 0) {
+            return true;
+        }
+        queue_head_ = send_end_[n - 1];
+    }
+    queue_.clear();
+    queue_head_ = 0;
+    send_buf_.clear();
+    return true;
+}
+
+}  // namespace wheel
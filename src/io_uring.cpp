@@ -0,0 +1,333 @@
+#include <wheel/io_uring.hpp>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+namespace wheel {
+
+namespace {
+
+int io_uring_setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, void* arg, size_t arg_size) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, arg_size));
+}
+
+int io_uring_register(int fd, unsigned opcode, void* arg, unsigned nr_args) {
+    return static_cast<int>(syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+// multishot recv came in 6.0, the probe only knows opcodes
+bool kernel_at_least(int major, int minor) {
+    utsname name;
+    if (uname(&name) != 0) {
+        return false;
+    }
+    int kernel_major = 0, kernel_minor = 0;
+    if (std::sscanf(name.release, "%d.%d", &kernel_major, &kernel_minor) != 2) {
+        return false;
+    }
+    return kernel_major > major || (kernel_major == major && kernel_minor >= minor);
+}
+
+}  // namespace
+
+IoUring::IoUring(unsigned entries) {
+    io_uring_params params{};
+    params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN;
+    params.cq_entries = entries * 4;  // multishot requests post many cqes per sqe
+    fd_ = io_uring_setup(entries, &params);
+    if (fd_ == -1 && errno == EINVAL) {  // COOP_TASKRUN is 5.19
+        params = {};
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = entries * 4;
+        fd_ = io_uring_setup(entries, &params);
+    }
+    if (fd_ == -1) {
+        return;
+    }
+    features_ = params.features;
+    if (!(features_ & IORING_FEAT_SINGLE_MMAP)) {
+        ::close(fd_);
+        fd_ = -1;
+        return;
+    }
+
+    ring_size_ = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned),
+                          params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    ring_ = mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+    if (ring_ == MAP_FAILED || sqes == MAP_FAILED) {
+        if (ring_ != MAP_FAILED) {
+            munmap(ring_, ring_size_);
+        }
+        if (sqes != MAP_FAILED) {
+            munmap(sqes, sqes_size_);
+        }
+        ring_ = nullptr;
+        ::close(fd_);
+        fd_ = -1;
+        return;
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    auto* base = static_cast<char*>(ring_);
+    sq_head_ = reinterpret_cast<unsigned*>(base + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+    sq_mask_ = *reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+    sq_entries_ = params.sq_entries;
+    sq_local_tail_ = *sq_tail_;
+    // sqe i always sits in slot i
+    auto* array = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+    for (unsigned i = 0; i < sq_entries_; ++i) {
+        array[i] = i;
+    }
+
+    cq_head_ = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+}
+
+IoUring::~IoUring() {
+    if (fd_ == -1) {
+        return;
+    }
+    // closing the ring cancels whatever is still in flight
+    ::close(fd_);
+    munmap(sqes_, sqes_size_);
+    munmap(ring_, ring_size_);
+    if (buf_ring_) {
+        munmap(buf_ring_, buf_ring_size_);
+        delete[] buffers_;
+    }
+}
+
+bool IoUring::supported() {
+    static const bool result = [] {
+        if (!kernel_at_least(6, 0)) {
+            return false;
+        }
+        IoUring ring(8);
+        if (!ring.ok() || !(ring.features_ & IORING_FEAT_EXT_ARG)) {
+            return false;
+        }
+        std::vector<char> storage(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op));
+        auto* probe = reinterpret_cast<io_uring_probe*>(storage.data());
+        if (io_uring_register(ring.fd_, IORING_REGISTER_PROBE, probe, 256) != 0) {
+            return false;
+        }
+        for (int op : {IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SEND, IORING_OP_POLL_ADD,
+                       IORING_OP_ASYNC_CANCEL, IORING_OP_SHUTDOWN}) {
+            if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+                return false;
+            }
+        }
+        return ring.init_buffers(0, 2, 64);
+    }();
+    return result;
+}
+
+bool IoUring::init_buffers(uint16_t group, unsigned count, unsigned size) {
+    if (buf_ring_ || count == 0 || (count & (count - 1)) || count > 32768) {
+        return false;
+    }
+    buf_ring_size_ = count * sizeof(io_uring_buf);
+    void* ring = mmap(nullptr, buf_ring_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED) {
+        return false;
+    }
+    io_uring_buf_reg reg{};
+    reg.ring_addr = reinterpret_cast<uint64_t>(ring);
+    reg.ring_entries = count;
+    reg.bgid = group;
+    if (io_uring_register(fd_, IORING_REGISTER_PBUF_RING, &reg, 1) != 0) {
+        munmap(ring, buf_ring_size_);
+        return false;
+    }
+    buf_ring_ = static_cast<io_uring_buf_ring*>(ring);
+    buffers_ = new char[static_cast<size_t>(count) * size];
+    buffer_count_ = count;
+    buffer_size_ = size;
+    for (unsigned i = 0; i < count; ++i) {
+        return_buffer(static_cast<uint16_t>(i));
+    }
+    return true;
+}
+
+void IoUring::return_buffer(uint16_t id) {
+    // not buf_ring_->bufs, in c++ the flex array wrapper moves it off by 8 bytes
+    auto& buf = reinterpret_cast<io_uring_buf*>(buf_ring_)[buf_tail_ & (buffer_count_ - 1)];
+    buf.addr = reinterpret_cast<uint64_t>(buffers_ + static_cast<size_t>(id) * buffer_size_);
+    buf.len = buffer_size_;
+    buf.bid = id;
+    ++buf_tail_;
+    ++buffers_free_;
+    std::atomic_ref<uint16_t>(buf_ring_->tail).store(buf_tail_, std::memory_order_release);
+}
+
+io_uring_sqe* IoUring::get_sqe_() {
+    unsigned head = std::atomic_ref<unsigned>(*sq_head_).load(std::memory_order_acquire);
+    if (sq_local_tail_ - head >= sq_entries_) {
+        submit_and_wait(0);
+        head = std::atomic_ref<unsigned>(*sq_head_).load(std::memory_order_acquire);
+        if (sq_local_tail_ - head >= sq_entries_) {
+            return nullptr;
+        }
+    }
+    auto* sqe = &sqes_[sq_local_tail_ & sq_mask_];
+    std::memset(sqe, 0, sizeof *sqe);
+    ++sq_local_tail_;
+    return sqe;
+}
+
+unsigned IoUring::cq_ready_() const {
+    return std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire) - *cq_head_;
+}
+
+bool IoUring::accept_multishot(int fd, uint64_t user_data) {
+    auto* sqe = get_sqe_();
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = user_data;
+    return true;
+}
+
+bool IoUring::recv_multishot(int fd, uint16_t group, uint64_t user_data) {
+    auto* sqe = get_sqe_();
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = group;
+    sqe->user_data = user_data;
+    return true;
+}
+
+bool IoUring::poll_multishot(int fd, uint32_t events, uint64_t user_data) {
+    auto* sqe = get_sqe_();
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->len = IORING_POLL_ADD_MULTI;
+    sqe->poll32_events = events;
+    sqe->user_data = user_data;
+    return true;
+}
+
+bool IoUring::poll(int fd, uint32_t events, uint64_t user_data) {
+    auto* sqe = get_sqe_();
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = events;
+    sqe->user_data = user_data;
+    return true;
+}
+
+bool IoUring::send(int fd, const void* buf, size_t len, uint64_t user_data, bool link) {
+    auto* sqe = get_sqe_();
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buf);
+    sqe->len = static_cast<uint32_t>(len);
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;  // the kernel retries short sends
+    sqe->flags = link ? IOSQE_IO_LINK : 0;
+    sqe->user_data = user_data;
+    return true;
+}
+
+bool IoUring::shutdown(int fd, int how, uint64_t user_data) {
+    auto* sqe = get_sqe_();
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_SHUTDOWN;
+    sqe->fd = fd;
+    sqe->len = how;
+    sqe->user_data = user_data;
+    return true;
+}
+
+bool IoUring::cancel(uint64_t target, uint64_t user_data) {
+    auto* sqe = get_sqe_();
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = target;
+    sqe->user_data = user_data;
+    return true;
+}
+
+bool IoUring::cancel_all(uint64_t user_data) {
+    auto* sqe = get_sqe_();
+    if (!sqe) {
+        return false;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+    sqe->user_data = user_data;
+    return true;
+}
+
+int IoUring::submit_and_wait(unsigned min_complete, int timeout_ms) {
+    unsigned to_submit = sq_local_tail_ - *sq_tail_;
+    std::atomic_ref<unsigned>(*sq_tail_).store(sq_local_tail_, std::memory_order_release);
+    if (min_complete && cq_ready_() >= min_complete) {
+        min_complete = 0;  // nothing to wait for
+    }
+    if (to_submit == 0 && min_complete == 0) {
+        return 0;
+    }
+
+    unsigned flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+    __kernel_timespec ts{};
+    io_uring_getevents_arg arg{};
+    void* argp = nullptr;
+    size_t arg_size = 0;
+    if (min_complete && timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1000000;
+        arg.ts = reinterpret_cast<uint64_t>(&ts);
+        argp = &arg;
+        arg_size = sizeof arg;
+        flags |= IORING_ENTER_EXT_ARG;
+    }
+    int ret = io_uring_enter(fd_, to_submit, min_complete, flags, argp, arg_size);
+    if (ret == -1 && (errno == ETIME || errno == EINTR)) {
+        return static_cast<int>(to_submit);
+    }
+    return ret;
+}
+
+}  // namespace wheel
@@ -1,53 +1,213 @@
 #include <wheel/message_handler.hpp>
 #include <wheel/log.hpp>
 
+#include <sys/socket.h>
+#include <poll.h>
+#include <cerrno>
+
 namespace wheel {
 
+// parse after every recv, the ring only ever holds the message being received
 bool MessageHandler::process() {
-    if (recv_()) {
-        if (ring_buffer_.size() >= 4) {
-            ring_buffer_.peek(buf_, 4);
-            int size = std::stoi(std::string(buf_, 4));
-            if (ring_buffer_.size() >= size + 4) {
-                ring_buffer_.pop(4);
-                ring_buffer_.get(buf_, size);
-                if (!process(std::string_view(buf_, size))) {
-                    return false;
-                }
+    while (true) {
+        int n;
+        if (!large_.empty()) {
+            n = ::recv(socket_, large_.data() + large_size_, large_.size() - large_size_, 0);
+        } else {
+            auto spans = ring_.write_spans();
+            iovec iov[2] = {{spans[0].data(), spans[0].size()}, {spans[1].data(), spans[1].size()}};
+            n = socket_.readv(iov, spans[1].empty() ? 1 : 2);
+        }
+        if (n > 0) {
+            if (!large_.empty()) {
+                large_size_ += n;
+            } else {
+                ring_.commit(n);
+            }
+            if (!drain_()) {
+                return false;
             }
+            // the rest waits in the socket until the output drained
+            update_throttle();
+            if (throttled()) {
+                break;
+            }
+        } else if (n == 0) {
+            wheel::Log::info("connection closed by peer");
+            return false;
+        } else if (errno == EAGAIN) {
+            break;
+        } else if (errno != EINTR) {
+            wheel::Log::error("socket recv error");
+            return false;
         }
-        return true;
-    } else {
-        return false;
     }
+    return true;
 }
 
-bool MessageHandler::send(wheel::Socket& socket, std::string_view msg) {
-    // TODO: optimize
-    std::string s = std::to_string(msg.size());
-    s.insert(s.begin(), 4 - s.size(), '0');
-    s += msg;
-    wheel::Log::info("send({}:{}): {}", socket.get_peer_ip(), socket.get_peer_port(), msg);
-    if (socket.send(s) == -1) {
-        wheel::Log::error("socket send error");
-        return false;
+bool MessageHandler::process(std::span<const char> head, std::span<const char> tail) {
+    if (tail.empty()) {
+        return process(std::string_view(head.data(), head.size()));
+    }
+    joined_.assign(head.data(), head.size());
+    joined_.append(tail.data(), tail.size());
+    return process(std::string_view(joined_));
+}
+
+// every complete message in the ring, popped once handled
+bool MessageHandler::drain_() {
+    if (!large_.empty()) {
+        if (large_size_ < large_.size()) {
+            return true;
+        }
+        bool ok = process(std::span<const char>(large_), {});
+        std::string().swap(large_);  // do not keep it for an idle connection
+        large_size_ = 0;
+        return ok;
+    }
+    while (ring_.size() > 0) {
+        char header[MAX_HEADER];
+        size_t size;
+        int header_size = decode_header(framing_, {header, ring_.peek(header, MAX_HEADER)}, size);
+        if (header_size == -1) {
+            wheel::Log::error("invalid message header");
+            return false;
+        }
+        if (header_size == 0) {
+            break;
+        }
+        if (header_size + size > RING_SIZE) {
+            // everything after the header is the start of this message
+            ring_.pop(header_size);
+            large_.resize(size);
+            large_size_ = ring_.get(large_, ring_.size());
+            return true;
+        }
+        if (ring_.size() < header_size + size) {
+            break;
+        }
+        auto spans = ring_.read_spans(header_size + size);
+        auto head = spans[0], tail = spans[1];
+        if (head.size() >= static_cast<size_t>(header_size)) {
+            head = head.subspan(header_size);
+        } else {  // the header itself wraps
+            head = tail.subspan(header_size - head.size());
+            tail = {};
+        }
+        bool ok = process(head, tail);
+        ring_.pop(header_size + size);
+        if (!ok) {
+            return false;
+        }
     }
     return true;
 }
 
-bool MessageHandler::recv_() {
-    int n = socket_.recv(buf_);
-    if (n > 0) {
-        ring_buffer_.put(buf_, n);
-        buf_[n] = 0;
-        wheel::Log::info("recv({}:{}): {}", socket_.get_peer_ip(), socket_.get_peer_port(), buf_);
-    } else if (n == 0) {
-        wheel::Log::info("connection closed by peer");
-        return false;
-    } else {
-        wheel::Log::error("socket recv error");
+size_t MessageHandler::encode_header(Framing framing, size_t size, char* out) {
+    if (size > MAX_MESSAGE) {
+        return 0;
+    }
+    switch (framing) {
+        case Framing::DECIMAL:
+            if (size > 9999) {
+                return 0;
+            }
+            for (int i = 3; i >= 0; --i, size /= 10) {
+                out[i] = static_cast<char>('0' + size % 10);
+            }
+            return 4;
+        case Framing::U32:
+            for (int i = 3; i >= 0; --i, size >>= 8) {
+                out[i] = static_cast<char>(size & 0xff);
+            }
+            return 4;
+        case Framing::VARINT: {
+            size_t n = 0;
+            do {
+                uint8_t byte = size & 0x7f;
+                size >>= 7;
+                out[n++] = static_cast<char>(size ? byte | 0x80 : byte);
+            } while (size);
+            return n;
+        }
+    }
+    return 0;
+}
+
+int MessageHandler::decode_header(Framing framing, std::string_view data, size_t& size) {
+    size = 0;
+    switch (framing) {
+        case Framing::DECIMAL:
+            if (data.size() < 4) {
+                return 0;
+            }
+            for (int i = 0; i < 4; ++i) {
+                if (data[i] < '0' || data[i] > '9') {
+                    return -1;
+                }
+                size = size * 10 + (data[i] - '0');
+            }
+            return 4;
+        case Framing::U32:
+            if (data.size() < 4) {
+                return 0;
+            }
+            for (int i = 0; i < 4; ++i) {
+                size = size << 8 | static_cast<uint8_t>(data[i]);
+            }
+            return size > MAX_MESSAGE ? -1 : 4;
+        case Framing::VARINT:
+            for (size_t i = 0; i < MAX_HEADER; ++i) {
+                if (i == data.size()) {
+                    return 0;
+                }
+                auto byte = static_cast<uint8_t>(data[i]);
+                size |= static_cast<size_t>(byte & 0x7f) << (7 * i);
+                if (!(byte & 0x80)) {
+                    return size > MAX_MESSAGE ? -1 : static_cast<int>(i + 1);
+                }
+            }
+            return -1;
+    }
+    return -1;
+}
+
+void MessageHandler::send(std::string_view msg) {
+    wheel::Log::info("send({}:{}): {}", socket_.get_peer_ip(), socket_.get_peer_port(), msg);
+    char header[MAX_HEADER];
+    size_t n = encode_header(framing_, msg.size(), header);
+    if (n == 0) {
+        wheel::Log::error("message too large: {} bytes", msg.size());
+        return;
+    }
+    write({header, n});
+    write(msg);
+}
+
+bool MessageHandler::send(wheel::Socket& socket, std::string_view msg, Framing framing) {
+    char header[MAX_HEADER];
+    size_t header_size = encode_header(framing, msg.size(), header);
+    if (header_size == 0) {
+        wheel::Log::error("message too large: {} bytes", msg.size());
         return false;
     }
+    std::string s(header, header_size);
+    s += msg;
+    wheel::Log::info("send({}:{}): {}", socket.get_peer_ip(), socket.get_peer_port(), msg);
+    std::string_view left = s;
+    while (!left.empty()) {
+        int n = socket.send(left);
+        if (n == -1) {
+            // non-blocking socket with a full buffer, wait until it drains
+            pollfd pfd{.fd = socket.fd(), .events = POLLOUT, .revents = 0};
+            if (errno == EAGAIN && ::poll(&pfd, 1, SEND_TIMEOUT_MS) == 1) {
+                continue;
+            }
+            wheel::Log::error("socket send error");
+            return false;
+        }
+        left.remove_prefix(n);
+    }
     return true;
 }
 
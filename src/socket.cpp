@@ -1,15 +1,70 @@
 #include <wheel/socket.hpp>
 #include <wheel/log.hpp>
 
+#include <fcntl.h>  // splice
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>  // TCP_NODELAY
+#include <netinet/udp.h>  // UDP_GRO
+#include <sys/sendfile.h>
+#include <sys/un.h>
+#include <cstddef>  // offsetof
 #include <cstring>
 
 namespace wheel {
 
-bool Socket::init(int flags) {
-    fd_ = socket(AF_INET, flags, 0);
+namespace {
+
+// abstract names start with a nul byte instead of '@' and are not nul terminated, the length says where they end
+// 0 if the path does not fit
+socklen_t unix_address(std::string_view path, sockaddr_un& addr) {
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof addr.sun_path) {
+        return 0;
+    }
+    path.copy(addr.sun_path, path.size());
+    if (path[0] == '@') {
+        addr.sun_path[0] = '\0';
+        return offsetof(sockaddr_un, sun_path) + path.size();
+    }
+    addr.sun_path[path.size()] = '\0';
+    return offsetof(sockaddr_un, sun_path) + path.size() + 1;
+}
+
+// "ip" and port of an accepted peer
+std::pair<std::string, unsigned short> peer_of(const sockaddr_storage& addr, socklen_t len) {
+    if (addr.ss_family == AF_INET) {
+        auto& in = reinterpret_cast<const sockaddr_in&>(addr);
+        char ip[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &in.sin_addr, ip, sizeof ip);
+        return {ip, ntohs(in.sin_port)};
+    }
+    if (addr.ss_family == AF_UNIX && len > offsetof(sockaddr_un, sun_path)) {
+        auto& un = reinterpret_cast<const sockaddr_un&>(addr);
+        size_t n = len - offsetof(sockaddr_un, sun_path);
+        if (un.sun_path[0] == '\0') {
+            return {"@" + std::string(un.sun_path + 1, n - 1), 0};
+        }
+        return {std::string(un.sun_path, strnlen(un.sun_path, n)), 0};
+    }
+    return {"", 0};
+}
+
+}  // namespace
+
+bool Socket::init(int flags, int domain) {
+    fd_ = socket(domain, flags, 0);
     return fd_ != -1;
 }
 
+std::optional<std::pair<Socket, Socket>> Socket::pair(int flags) {
+    int fds[2];
+    if (socketpair(AF_UNIX, flags, 0, fds) == -1) {
+        return std::nullopt;
+    }
+    return std::pair<Socket, Socket>{Socket(fds[0], "", 0), Socket(fds[1], "", 0)};
+}
+
 bool Socket::bind(std::string_view ip, unsigned short port) {
     struct sockaddr_in saddr {
         .sin_family = AF_INET,
@@ -22,30 +77,83 @@ bool Socket::bind(std::string_view ip, unsigned short port) {
     return ::bind(fd_, reinterpret_cast<struct sockaddr*>(&saddr), sizeof saddr) != -1;
 }
 
-bool Socket::listen() {
-    return ::listen(fd_, 128) != -1;
+bool Socket::listen(int backlog) {
+    return ::listen(fd_, backlog) != -1;
 }
 
 std::optional<Socket> Socket::accept(int flags) {
-    struct sockaddr_in caddr;
+    struct sockaddr_storage caddr;
     socklen_t caddr_len = sizeof caddr;
     int cfd = accept4(fd_, reinterpret_cast<struct sockaddr*>(&caddr), &caddr_len, flags);
     if (cfd == -1) {
         return std::nullopt;
     }
-    return std::optional<Socket>({cfd, inet_ntoa(caddr.sin_addr), ntohs(caddr.sin_port)});
+    auto [ip, port] = peer_of(caddr, caddr_len);
+    return std::optional<Socket>({cfd, ip, port});
+}
+
+Socket Socket::adopt(int fd) {
+    struct sockaddr_storage caddr {};
+    socklen_t caddr_len = sizeof caddr;
+    if (getpeername(fd, reinterpret_cast<struct sockaddr*>(&caddr), &caddr_len) == -1) {
+        return {fd, "", 0};
+    }
+    auto [ip, port] = peer_of(caddr, caddr_len);
+    return {fd, ip, port};
 }
 
 bool Socket::connect(std::string_view ip, unsigned short port) {
+    std::string address(ip);
+    if (ip.find(':') != std::string_view::npos) {
+        sockaddr_in6 saddr{};
+        saddr.sin6_family = AF_INET6;
+        saddr.sin6_port = htons(port);
+        if (inet_pton(AF_INET6, address.c_str(), &saddr.sin6_addr) != 1) {
+            errno = EINVAL;
+            return false;
+        }
+        return ::connect(fd_, reinterpret_cast<struct sockaddr*>(&saddr), sizeof saddr) != -1;
+    }
     struct sockaddr_in saddr {
         .sin_family = AF_INET,
         .sin_port = htons(port),
     };
-    inet_pton(AF_INET, ip.data(), &saddr.sin_addr.s_addr);
+    inet_pton(AF_INET, address.c_str(), &saddr.sin_addr.s_addr);
 
     return ::connect(fd_, reinterpret_cast<struct sockaddr*>(&saddr), sizeof saddr) != -1;
 }
 
+int Socket::error() {
+    int error = 0;
+    socklen_t len = sizeof error;
+    if (getsockopt(fd_, SOL_SOCKET, SO_ERROR, &error, &len) == -1) {
+        return errno;
+    }
+    return error;
+}
+
+bool Socket::bind_unix(std::string_view path) {
+    sockaddr_un addr{};
+    socklen_t len = unix_address(path, addr);
+    if (len == 0) {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    ip_ = path;
+    port_ = 0;
+    return ::bind(fd_, reinterpret_cast<struct sockaddr*>(&addr), len) != -1;
+}
+
+bool Socket::connect_unix(std::string_view path) {
+    sockaddr_un addr{};
+    socklen_t len = unix_address(path, addr);
+    if (len == 0) {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    return ::connect(fd_, reinterpret_cast<struct sockaddr*>(&addr), len) != -1;
+}
+
 bool Socket::close() {
     if (fd_ == -1)
         return false;
@@ -55,9 +163,87 @@ bool Socket::close() {
     return true;
 }
 
+bool Socket::set_option_(int level, int name, int value) {
+    return setsockopt(fd_, level, name, &value, sizeof(int)) != -1;
+}
+
 bool Socket::set_reuse_addr() {
-    int reuse = 1;
-    return setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(int)) != -1;
+    return set_option_(SOL_SOCKET, SO_REUSEADDR, 1);
+}
+
+bool Socket::set_reuse_port() {
+    return set_option_(SOL_SOCKET, SO_REUSEPORT, 1);
+}
+
+bool Socket::set_nodelay(bool on) {
+    return set_option_(IPPROTO_TCP, TCP_NODELAY, on);
+}
+
+bool Socket::set_cork(bool on) {
+    return set_option_(IPPROTO_TCP, TCP_CORK, on);
+}
+
+bool Socket::set_quickack(bool on) {
+    return set_option_(IPPROTO_TCP, TCP_QUICKACK, on);
+}
+
+bool Socket::set_recv_buffer(int bytes) {
+    return set_option_(SOL_SOCKET, SO_RCVBUF, bytes);
+}
+
+bool Socket::set_send_buffer(int bytes) {
+    return set_option_(SOL_SOCKET, SO_SNDBUF, bytes);
+}
+
+bool Socket::set_busy_poll(int usec) {
+    return set_option_(SOL_SOCKET, SO_BUSY_POLL, usec);
+}
+
+bool Socket::set_defer_accept(int seconds) {
+    return set_option_(IPPROTO_TCP, TCP_DEFER_ACCEPT, seconds);
+}
+
+bool Socket::set_fastopen(int queue) {
+    return set_option_(IPPROTO_TCP, TCP_FASTOPEN, queue);
+}
+
+bool Socket::set_incoming_cpu(int cpu) {
+    return set_option_(SOL_SOCKET, SO_INCOMING_CPU, cpu);
+}
+
+bool Socket::apply(const SocketOptions& options) {
+    bool ok = true;
+    auto set = [&](const auto& value, auto setter, const char* name) {
+        if (value && !(this->*setter)(*value)) {
+            Log::error("socket set {} error: {}(errno: {})", name, std::strerror(errno), errno);
+            ok = false;
+        }
+    };
+    set(options.nodelay, &Socket::set_nodelay, "nodelay");
+    set(options.cork, &Socket::set_cork, "cork");
+    set(options.quickack, &Socket::set_quickack, "quickack");
+    set(options.recv_buffer, &Socket::set_recv_buffer, "recv_buffer");
+    set(options.send_buffer, &Socket::set_send_buffer, "send_buffer");
+    set(options.busy_poll, &Socket::set_busy_poll, "busy_poll");
+    set(options.defer_accept, &Socket::set_defer_accept, "defer_accept");
+    set(options.fastopen, &Socket::set_fastopen, "fastopen");
+    set(options.incoming_cpu, &Socket::set_incoming_cpu, "incoming_cpu");
+    return ok;
+}
+
+bool Socket::set_zerocopy() {
+    int one = 1;
+    return setsockopt(fd_, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(int)) != -1;
+}
+
+bool Socket::set_gro() {
+    int one = 1;
+    return setsockopt(fd_, SOL_UDP, UDP_GRO, &one, sizeof(int)) != -1;
+}
+
+bool Socket::set_gso(uint16_t segment) {
+    int size = segment;
+    return setsockopt(fd_, SOL_UDP, UDP_SEGMENT, &size, sizeof(int)) != -1;
 }
 
 int Socket::send(std::string_view s) {
@@ -65,6 +251,53 @@ int Socket::send(std::string_view s) {
     return ::send(fd_, s.data(), s.length(), 0);
 }
 
+// sendmsg instead of ::writev for MSG_NOSIGNAL, a closed peer is an error, not a SIGPIPE
+int Socket::writev(const iovec* iov, int count, bool more) {
+    msghdr msg{};
+    msg.msg_iov = const_cast<iovec*>(iov);
+    msg.msg_iovlen = count;
+    return ::sendmsg(fd_, &msg, more ? MSG_NOSIGNAL | MSG_MORE : MSG_NOSIGNAL);
+}
+
+int Socket::send_zerocopy(std::string_view s) {
+    return ::send(fd_, s.data(), s.length(), MSG_ZEROCOPY | MSG_NOSIGNAL);
+}
+
+bool Socket::read_zerocopy_completion(uint32_t& lo, uint32_t& hi, bool& copied) {
+    char control[CMSG_SPACE(sizeof(sock_extended_err) + sizeof(sockaddr_in6))];
+    while (true) {
+        msghdr msg{};
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof control;
+        if (::recvmsg(fd_, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+            return false;
+        }
+        for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            bool recverr = (cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR)
+                || (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR);
+            auto* err = reinterpret_cast<sock_extended_err*>(CMSG_DATA(cm));
+            if (recverr && err->ee_errno == 0 && err->ee_origin == SO_EE_ORIGIN_ZEROCOPY) {
+                lo = err->ee_info;
+                hi = err->ee_data;
+                copied = err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED;
+                return true;
+            }
+        }
+        // something else on the error queue, skip it
+    }
+}
+
+long Socket::sendfile(int file_fd, long& offset, size_t count) {
+    off_t off = offset;
+    ssize_t n = ::sendfile(fd_, file_fd, &off, count);
+    offset = off;
+    return n;
+}
+
+long Socket::splice_from(int pipe_fd, size_t count) {
+    return ::splice(pipe_fd, nullptr, fd_, nullptr, count, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+}
+
 int Socket::recv(std::span<char> buf) {
     int n = ::recv(fd_, buf.data(), buf.size(), 0);
     if (n == -1) {
@@ -77,4 +310,64 @@ int Socket::recv(std::span<char> buf) {
     return n;
 }
 
+int Socket::readv(const iovec* iov, int count) {
+    return ::readv(fd_, iov, count);
+}
+
+int Socket::recvmmsg(mmsghdr* msgs, unsigned count) {
+    return ::recvmmsg(fd_, msgs, count, 0, nullptr);
+}
+
+int Socket::sendmmsg(mmsghdr* msgs, unsigned count) {
+    return ::sendmmsg(fd_, msgs, count, MSG_NOSIGNAL);
+}
+
+int Socket::send_fds(std::string_view s, std::span<const int> fds) {
+    if (s.empty() || fds.size() > MAX_FDS) {
+        errno = EINVAL;
+        return -1;
+    }
+    iovec iov{const_cast<char*>(s.data()), s.size()};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * MAX_FDS)];
+    if (!fds.empty()) {
+        msg.msg_control = control;
+        msg.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+        cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+        cm->cmsg_level = SOL_SOCKET;
+        cm->cmsg_type = SCM_RIGHTS;
+        cm->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+        std::memcpy(CMSG_DATA(cm), fds.data(), sizeof(int) * fds.size());
+    }
+    return ::sendmsg(fd_, &msg, MSG_NOSIGNAL);
+}
+
+int Socket::recv_fds(std::span<char> buf, std::vector<int>& fds) {
+    iovec iov{buf.data(), buf.size()};
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * MAX_FDS)];
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof control;
+    int n = ::recvmsg(fd_, &msg, MSG_CMSG_CLOEXEC);
+    if (n == -1) {
+        return -1;
+    }
+    for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+        if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_RIGHTS) {
+            size_t count = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            size_t old = fds.size();
+            fds.resize(old + count);
+            std::memcpy(fds.data() + old, CMSG_DATA(cm), sizeof(int) * count);
+        }
+    }
+    if (msg.msg_flags & MSG_CTRUNC) [[unlikely]] {
+        Log::error("Socket::recv_fds: control data truncated, fds lost");
+    }
+    return n;
+}
+
 } // namespace wheel
@@ -0,0 +1,276 @@
+#include <wheel/socket_handler.hpp>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <mutex>
+#include <utility>
+
+namespace wheel {
+
+namespace {
+
+// zerocopy buffers of destroyed handlers: a graceful close still delivers the queued data(retransmits too)
+// from their pages, so they stay alive with a dup of the socket until the kernel reported them done
+struct Lingering {
+    Socket socket;
+    std::vector<std::pair<uint32_t, std::shared_ptr<const std::string>>> buffers;  // {seq, data}
+};
+
+std::mutex lingering_mutex;
+std::vector<Lingering> lingering;
+std::atomic<bool> any_lingering = false;
+
+// from every flush and handler destruction(any thread, whoever gets the lock), a relaxed load when there is none
+void reap_lingering() {
+    if (!any_lingering.load(std::memory_order_relaxed)) {
+        return;
+    }
+    std::unique_lock lock(lingering_mutex, std::try_to_lock);
+    if (!lock) {
+        return;
+    }
+    std::erase_if(lingering, [](Lingering& entry) {
+        uint32_t lo, hi;
+        bool copied;
+        while (entry.socket.read_zerocopy_completion(lo, hi, copied)) {
+            std::erase_if(entry.buffers, [lo, hi](const auto& buffer) { return buffer.first - lo <= hi - lo; });
+        }
+        return entry.buffers.empty();  // closes the dup
+    });
+    any_lingering.store(!lingering.empty(), std::memory_order_relaxed);
+}
+
+}  // namespace
+
+SocketHandler::~SocketHandler() {
+    while (!out_empty_()) {
+        pop_();
+    }
+    if (!zerocopy_.empty() && socket_.fd() != -1) {
+        reap_zerocopy_();
+        if (!zerocopy_.empty()) {
+            linger_();
+        }
+    }
+    reap_lingering();
+}
+
+// the socket is closed right after, the dup keeps it open for the completions: shutdown sends the FIN now
+void SocketHandler::linger_() {
+    int fd = fcntl(socket_.fd(), F_DUPFD_CLOEXEC, 0);
+    if (fd == -1) {
+        return;
+    }
+    ::shutdown(socket_.fd(), SHUT_WR);
+    Lingering entry{Socket::adopt(fd), {}};
+    for (auto& z : zerocopy_) {
+        entry.buffers.emplace_back(z.seq, std::move(z.data));
+    }
+    zerocopy_.clear();
+    std::lock_guard lock(lingering_mutex);
+    lingering.push_back(std::move(entry));
+    any_lingering.store(true, std::memory_order_relaxed);
+}
+
+bool SocketHandler::on_error() {
+    if (!zerocopy_.empty()) {
+        reap_zerocopy_();
+    }
+    int err = 0;
+    socklen_t len = sizeof err;
+    return getsockopt(socket_, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0;
+}
+
+namespace {
+
+// hysteresis: once above high, throttled until back at low
+bool above(bool throttled, size_t bytes, const Watermarks& marks) {
+    if (marks.high == 0) {
+        return false;
+    }
+    return throttled ? bytes > marks.low : bytes >= marks.high;
+}
+
+}  // namespace
+
+void SocketHandler::set_watermarks(const Watermarks& input, const Watermarks& output) {
+    input_marks_ = input;
+    output_marks_ = output;
+}
+
+bool SocketHandler::update_throttle(size_t queued) {
+    bool was = throttled();
+    input_throttled_ = above(input_throttled_, pending_input(), input_marks_);
+    output_throttled_ = above(output_throttled_, pending_output() + queued, output_marks_);
+    if (throttled() == was) {
+        return false;
+    }
+    if (throttled()) {
+        on_throttle();
+    } else {
+        on_unthrottle();
+    }
+    return true;
+}
+
+void SocketHandler::write(std::string_view data) {
+    if (data.empty()) {
+        return;
+    }
+    if (!out_empty_() && out_.back().file == -1 && !out_.back().shared
+            && out_.back().data.size() + data.size() <= COALESCE_SIZE) {
+        out_.back().data.append(data);
+    } else {
+        out_.emplace_back().data = data;
+    }
+    out_bytes_ += data.size();
+}
+
+void SocketHandler::write_zerocopy(std::shared_ptr<const std::string> data) {
+    if (!data || data->empty()) {
+        return;
+    }
+    out_bytes_ += data->size();
+    out_.emplace_back().shared = std::move(data);
+}
+
+bool SocketHandler::write_file(int fd, long offset, size_t count) {
+    if (count == 0) {
+        return true;
+    }
+    int file = ::dup(fd);
+    if (file == -1) {
+        return false;
+    }
+    auto& chunk = out_.emplace_back();
+    chunk.file = file;
+    chunk.offset = offset;
+    chunk.size = count;
+    out_bytes_ += count;
+    return true;
+}
+
+bool SocketHandler::flush() {
+    if (!zerocopy_.empty()) {
+        reap_zerocopy_();
+    }
+    reap_lingering();
+    while (!out_empty_()) {
+        auto& chunk = out_[out_head_];
+        int ret = chunk.file != -1 ? flush_file_(chunk) : chunk.shared ? flush_zerocopy_(chunk) : flush_copy_();
+        if (ret == -1) {
+            return errno == EAGAIN;
+        }
+        if (ret == 0) {  // socket buffer is full
+            break;
+        }
+    }
+    return true;
+}
+
+// the flush_*_ return -1 on error, 0 if the socket took less than offered, else 1
+
+// every plain chunk at the front in one writev
+int SocketHandler::flush_copy_() {
+    iovec iov[MAX_IOV];
+    int count = 0;
+    size_t total = 0;
+    auto it = out_.begin() + out_head_;
+    for (; it != out_.end() && count < MAX_IOV && it->file == -1 && !it->shared; ++it, ++count) {
+        iov[count] = {it->data.data() + it->offset, it->left()};
+        total += iov[count].iov_len;
+    }
+    // a file or more chunks follow, a short tail(headers before a sendfile) waits to share their segment
+    int n = socket_.writev(iov, count, it != out_.end());
+    if (n == -1) {
+        return -1;
+    }
+
+    out_bytes_ -= n;
+    size_t sent = n;
+    while (sent > 0) {
+        auto& chunk = out_[out_head_];
+        if (sent < chunk.left()) {
+            chunk.offset += sent;
+            break;
+        }
+        sent -= chunk.left();
+        pop_();
+    }
+    return static_cast<size_t>(n) == total;
+}
+
+int SocketHandler::flush_zerocopy_(Chunk& chunk) {
+    if (zerocopy_state_ == 0) {
+        zerocopy_state_ = socket_.set_zerocopy() ? 1 : -1;
+    }
+    iovec iov{const_cast<char*>(chunk.shared->data()) + chunk.offset, chunk.left()};
+    bool zerocopy = zerocopy_state_ == 1;
+    int n = zerocopy ? socket_.send_zerocopy({chunk.shared->data() + chunk.offset, chunk.left()}) : -1;
+    if (n == -1 && (!zerocopy || errno == ENOBUFS)) {  // ENOBUFS: too many completions not reaped yet
+        zerocopy = false;
+        n = socket_.writev(&iov, 1);
+    }
+    if (n == -1) {
+        return -1;
+    }
+    if (zerocopy) {
+        zerocopy_.push_back({zerocopy_seq_++, chunk.shared});
+    }
+    out_bytes_ -= n;
+    chunk.offset += n;
+    if (chunk.left() > 0) {
+        return 0;
+    }
+    pop_();
+    return 1;
+}
+
+int SocketHandler::flush_file_(Chunk& chunk) {
+    long n = socket_.sendfile(chunk.file, chunk.offset, chunk.size);
+    if (n == -1) {
+        return -1;
+    }
+    if (n == 0) {  // the file is shorter than the region
+        out_bytes_ -= chunk.size;
+        pop_();
+        return 1;
+    }
+    out_bytes_ -= n;
+    chunk.size -= n;
+    if (chunk.size > 0) {
+        return 0;
+    }
+    pop_();
+    return 1;
+}
+
+void SocketHandler::reap_zerocopy_() {
+    uint32_t lo, hi;
+    bool copied;
+    while (socket_.read_zerocopy_completion(lo, hi, copied)) {
+        std::erase_if(zerocopy_, [lo, hi](const Zerocopy& z) { return z.seq - lo <= hi - lo; });
+        if (copied) {
+            zerocopy_state_ = -1;  // e.g. loopback, the kernel copies anyway so a plain send is cheaper
+        }
+    }
+}
+
+void SocketHandler::pop_() {
+    auto& chunk = out_[out_head_];
+    if (chunk.file != -1) {
+        ::close(chunk.file);
+    }
+    chunk = {};
+    if (++out_head_ == out_.size()) {
+        out_.clear();
+        out_head_ = 0;
+    }
+}
+
+}  // namespace wheel
@@ -0,0 +1,37 @@
+#include <wheel/stream_handler.hpp>
+
+#include <cerrno>
+
+namespace wheel {
+
+bool StreamHandler::process() {
+    bool open = true;
+    bool ok = true;
+    while (open) {
+        int n = ::recv(socket_, buf_, sizeof buf_, 0);
+        if (n > 0) {
+            open = on_recv({buf_, static_cast<size_t>(n)}, reply_);
+            // the rest waits in the socket until the output drained
+            update_throttle(reply_.size());
+            if (throttled()) {
+                break;
+            }
+        } else if (n == 0) {
+            open = false;
+        } else if (errno != EINTR) {
+            ok = errno == EAGAIN;
+            break;
+        }
+    }
+    // one writev for everything answered in this call, by the server after process()
+    write(reply_);
+    reply_.clear();
+    if (!open) {
+        // closed right away only if the socket took everything, else the server sends the rest first
+        close_after_output();
+        return ok && flush() && pending_output() > 0;
+    }
+    return ok;
+}
+
+}  // namespace wheel
@@ -1,37 +1,607 @@
 #include <wheel/thread_pool.hpp>
 
+#include <wheel/free_list.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
 namespace wheel {
 
-ThreadPool::ThreadPool(int num) {
+// written only by the thread that runs the tasks, read by stats() and snapshot()
+template <template <typename> typename Queue>
+struct BasicThreadPool<Queue>::Counters {
+    std::array<ConcurrentHistogram, NUM_PRIORITIES> queue_wait;
+    std::array<ConcurrentHistogram, NUM_PRIORITIES> run_time;
+    std::array<std::atomic<uint64_t>, NUM_PRIORITIES> executed{};
+    std::array<std::atomic<uint64_t>, NUM_PRIORITIES> dropped{};
+    std::array<std::atomic<uint64_t>, NUM_PRIORITIES> demoted{};
+    std::atomic<uint64_t> steals = 0;
+    std::atomic<uint64_t> parks = 0;
+    std::atomic<uint64_t> wakeups = 0;
+    std::atomic<int64_t> idle_ns = 0;
+};
+
+template <template <typename> typename Queue>
+struct BasicThreadPool<Queue>::Worker {
+    std::thread thread;
+    WorkStealingDeque<Task*> deque;  // NORMAL tasks pushed by this worker
+    int index;
+    std::atomic<int> node = -1;  // NUMA node of its cpus, -1 if not pinned to one node, read by thieves
+    std::atomic<bool> retired = false;  // the thread is done, the slot can be reused
+    std::vector<int> cpus;  // empty if not pinned
+    std::string name;
+    uint32_t seed;  // xorshift state for choosing victims
+    uint32_t picks = 0;  // tasks taken so far, drives the starvation protection
+    Counters counters;
+};
+
+namespace {
+
+constexpr bool STATS = WHEEL_THREAD_POOL_STATS;
+
+// worker running on this thread and the pool it belongs to
+thread_local const void* current_pool = nullptr;
+thread_local void* current_worker = nullptr;
+thread_local uint32_t helper_seed = 0x2545f491;  // victim choosing for threads outside the pool
+thread_local uint32_t sample_tick = 0;  // pushes from this thread, picks the tasks whose time is measured
+
+// tasks in the work stealing deques are boxed, recycle the boxes instead of new / delete
+template <typename T>
+T* box(T&& task) {
+    return new (FreeList<sizeof(T)>::allocate()) T(std::move(task));
+}
+
+template <typename T>
+T unbox(T* ptr) {
+    T task = std::move(*ptr);
+    ptr->~T();
+    FreeList<sizeof(T)>::deallocate(ptr);
+    return task;
+}
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// only one thread writes, so no locked instruction is needed
+template <typename T>
+void bump(std::atomic<T>& counter, T n = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+template <typename Counters>
+void add_priority_stats(const Counters& counters, int index, PriorityStats& stats) {
+    counters.queue_wait[index].snapshot_into(stats.queue_wait);
+    counters.run_time[index].snapshot_into(stats.run_time);
+    stats.executed += counters.executed[index].load(std::memory_order_relaxed);
+    stats.dropped += counters.dropped[index].load(std::memory_order_relaxed);
+    stats.demoted += counters.demoted[index].load(std::memory_order_relaxed);
+}
+
+// LATENCY first, but every 8th pick starts at NORMAL and every 64th at BACKGROUND, so no class starves
+constexpr Priority PICK_ORDERS[3][NUM_PRIORITIES] = {
+    {Priority::LATENCY, Priority::NORMAL, Priority::BACKGROUND},
+    {Priority::NORMAL, Priority::LATENCY, Priority::BACKGROUND},
+    {Priority::BACKGROUND, Priority::LATENCY, Priority::NORMAL},
+};
+
+const Priority* pick_order(uint32_t picks) {
+    if (picks % 64 == 63) {
+        return PICK_ORDERS[2];
+    }
+    return PICK_ORDERS[picks % 8 == 7 ? 1 : 0];
+}
+
+void cpu_relax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+uint32_t xorshift(uint32_t& x) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return x;
+}
+
+}  // namespace
+
+template <template <typename> typename Queue>
+BasicThreadPool<Queue>::BasicThreadPool(int num, Mode mode, PlacementPolicy placement)
+    : mode_(mode), placement_(std::move(placement)), workers_(MAX_THREADS), helper_counters_(std::make_unique<Counters>()) {
     add_thread(num);
 }
 
-void ThreadPool::add_thread(int num) {
+template <template <typename> typename Queue>
+void BasicThreadPool<Queue>::add_thread(int num) {
+    std::lock_guard<std::mutex> lock(grow_mutex_);
     for (int i = 0; i < num; ++i) {
-        threads_.emplace_back([this] {
-            while (true) {
-                std::unique_lock<std::mutex> lock(mutex_);
-                cv_.wait(lock, [this] { return stop_ || !task_queue_.empty(); });
-                if (stop_ && task_queue_.empty()) {
-                    return;
+        int index = free_slot_();
+        if (index < 0) {
+            throw std::length_error("ThreadPool: too many threads");
+        }
+        start_worker_(index);
+    }
+}
+
+template <template <typename> typename Queue>
+void BasicThreadPool<Queue>::set_elastic(const ElasticPolicy& policy) {
+    max_threads_.store(std::min(policy.max_threads, MAX_THREADS), std::memory_order_relaxed);
+    grow_queue_depth_.store(std::max(policy.grow_queue_depth, 1), std::memory_order_relaxed);
+    spin_ns_.store(std::chrono::duration_cast<std::chrono::nanoseconds>(policy.spin).count(), std::memory_order_relaxed);
+    {
+        // parked workers wake up once and park again with the new timeout
+        std::unique_lock<std::mutex> lock(mutex_);
+        min_threads_ = std::min(policy.min_threads, MAX_THREADS);
+        idle_timeout_ = policy.idle_timeout;
+        wakeups_ = sleepers_.load(std::memory_order_relaxed);
+    }
+    cv_.notify_all();
+    if (int missing = policy.min_threads - size(); missing > 0) {
+        add_thread(missing);
+    }
+}
+
+// a retired slot, or the next unused one, -1 if every slot runs a thread
+// grow_mutex_ must be held
+template <template <typename> typename Queue>
+int BasicThreadPool<Queue>::free_slot_() {
+    int n = num_slots_.load(std::memory_order_relaxed);
+    for (int i = 0; i < n; ++i) {
+        if (workers_[i]->retired.load(std::memory_order_acquire)) {
+            return i;
+        }
+    }
+    return n < MAX_THREADS ? n : -1;
+}
+
+// grow_mutex_ must be held
+template <template <typename> typename Queue>
+void BasicThreadPool<Queue>::start_worker_(int index) {
+    auto& slot = workers_[index];
+    bool reuse = slot != nullptr;
+    if (reuse) {
+        slot->thread.join();  // already returned, it marked the slot retired as its last step
+        slot->retired.store(false, std::memory_order_relaxed);
+    } else {
+        slot = std::make_unique<Worker>();
+        slot->index = index;
+    }
+    Worker& worker = *slot;
+    worker.cpus = placement_.cpus_for(index);
+    int node = worker.cpus.empty() ? -1 : numa_node_of(worker.cpus.front());
+    for (int cpu : worker.cpus) {
+        if (numa_node_of(cpu) != node) {
+            node = -1;
+        }
+    }
+    worker.node.store(node, std::memory_order_relaxed);
+    worker.name = placement_.name.empty() ? std::string() : placement_.name + "/" + std::to_string(index);
+    worker.seed = static_cast<uint32_t>(index) * 0x9e3779b9u + 1;
+    if (!reuse) {
+        num_slots_.store(index + 1, std::memory_order_release);  // publish to thieves
+    }
+    threads_.fetch_add(1, std::memory_order_release);
+    worker.thread = std::thread([this, &worker] { run_(worker); });
+}
+
+// called after a push found every worker busy and tasks piling up
+template <template <typename> typename Queue>
+void BasicThreadPool<Queue>::grow_() {
+    std::unique_lock<std::mutex> lock(grow_mutex_, std::try_to_lock);
+    if (!lock || stop_ || threads_.load(std::memory_order_relaxed) >= max_threads_.load(std::memory_order_relaxed)) {
+        return;  // someone else is growing, or stopping
+    }
+    if (int index = free_slot_(); index >= 0) {
+        start_worker_(index);
+        grows_.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+template <template <typename> typename Queue>
+BasicThreadPool<Queue>::~BasicThreadPool() {
+    {
+        std::lock_guard<std::mutex> grow_lock(grow_mutex_);  // no thread starts after this
+        std::unique_lock<std::mutex> lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+    int n = num_slots_.load(std::memory_order_acquire);
+    for (int i = 0; i < n; ++i) {
+        if (workers_[i]->thread.joinable()) {
+            workers_[i]->thread.join();
+        }
+    }
+}
+
+template <template <typename> typename Queue>
+void BasicThreadPool<Queue>::push_(const TaskOptions& options, Job&& job) {
+    Task task{std::move(job), 0, 0, options.priority, options.on_deadline};
+    if constexpr (STATS) {
+        uint32_t period = sample_period_.load(std::memory_order_relaxed);
+        if (period != 0 && ++sample_tick % period == 0) {
+            task.enqueue_time = now_ns();
+        }
+    }
+    if (options.deadline != std::chrono::steady_clock::time_point::max()) {
+        task.deadline = std::chrono::duration_cast<std::chrono::nanoseconds>(options.deadline.time_since_epoch()).count();
+    }
+    push_(std::move(task));
+}
+
+template <template <typename> typename Queue>
+void BasicThreadPool<Queue>::push_(Task&& task) {
+    Lane& lane = lanes_[static_cast<int>(task.priority)];
+    Worker* local = nullptr;
+    if (mode_ == Mode::WORK_STEALING && task.priority == Priority::NORMAL && current_pool == this) {
+        local = static_cast<Worker*>(current_worker);
+        local->deque.push(box(std::move(task)));
+    } else if (!lane.queue.try_push(std::move(task))) {
+        // a bounded queue is full, waiting here could deadlock when every worker is pushing
+        lane.overflow.push(std::move(task));
+        lane.overflow_size.fetch_add(1, std::memory_order_release);
+    }
+    notify_();
+
+    // more tasks pile up than the idle workers can take
+    if (max_threads_.load(std::memory_order_relaxed) > threads_.load(std::memory_order_relaxed)) {
+        int64_t depth = local ? local->deque.size()
+                              : static_cast<int64_t>(lane.queue.size()) + lane.overflow_size.load(std::memory_order_relaxed);
+        int idle = sleepers_.load(std::memory_order_relaxed) + spinning_.load(std::memory_order_relaxed);
+        if (depth - idle >= grow_queue_depth_.load(std::memory_order_relaxed)) {
+            grow_();
+        }
+    }
+}
+
+template <template <typename> typename Queue>
+void BasicThreadPool<Queue>::run_(Worker& worker) {
+    current_pool = this;
+    current_worker = &worker;
+    if (!worker.cpus.empty()) {
+        set_thread_affinity(worker.cpus);
+    }
+    if (!worker.name.empty()) {
+        set_thread_name(worker.name);
+    }
+
+    Task task;
+    while (true) {
+        if (get_task_(&worker, task)) {
+            execute_(&worker, task);
+            continue;
+        }
+        // only exit when there is nothing left to run
+        if (stop_) {
+            return;
+        }
+        int64_t idle_start = STATS ? now_ns() : 0;
+        bool alive = spin_() || park_(worker);
+        if constexpr (STATS) {
+            bump(worker.counters.idle_ns, now_ns() - idle_start);
+        }
+        if (!alive) {
+            worker.retired.store(true, std::memory_order_release);  // must be the last access to this pool
+            return;
+        }
+    }
+}
+
+template <template <typename> typename Queue>
+bool BasicThreadPool<Queue>::run_pending_task() {
+    Worker* worker = current_pool == this ? static_cast<Worker*>(current_worker) : nullptr;
+    Task task;
+    if (!get_task_(worker, task)) {
+        return false;
+    }
+    execute_(worker, task);
+    return true;
+}
+
+template <template <typename> typename Queue>
+int BasicThreadPool<Queue>::current_worker_index() const {
+    return current_pool == this ? static_cast<Worker*>(current_worker)->index : -1;
+}
+
+// run the task, or drop / demote it when its deadline passed while queued
+template <template <typename> typename Queue>
+void BasicThreadPool<Queue>::execute_(Worker* worker, Task& task) {
+    bool sampled = STATS && task.enqueue_time != 0;
+    int64_t now = sampled || task.deadline != 0 ? now_ns() : 0;
+    Priority priority = task.priority;
+    int index = static_cast<int>(priority);
+    bool expired = task.deadline != 0 && now > task.deadline;
+
+    // workers own their counters, helpers share one set under a lock
+    auto update = [&](auto&& f) {
+        if constexpr (STATS) {
+            if (worker) {
+                f(worker->counters);
+            } else {
+                std::lock_guard<std::mutex> lock(helper_mutex_);
+                f(*helper_counters_);
+            }
+        }
+    };
+    update([&](Counters& counters) {
+        if (!expired) {
+            bump(counters.executed[index]);
+            if (sampled) {
+                counters.queue_wait[index].record(now - task.enqueue_time);
+            }
+        } else if (task.on_deadline == DeadlinePolicy::DEMOTE) {
+            bump(counters.demoted[index]);
+        } else {
+            bump(counters.dropped[index]);
+        }
+    });
+
+    if (!expired) {
+        task.job();
+        if (sampled) {
+            int64_t run_time = now_ns() - now;
+            update([&](Counters& counters) { counters.run_time[index].record(run_time); });
+        }
+    } else if (task.on_deadline == DeadlinePolicy::DEMOTE) {
+        task.priority = Priority::BACKGROUND;
+        task.deadline = 0;
+        push_(std::move(task));
+    }
+    task.job = nullptr;
+
+    if (priority == Priority::BACKGROUND) {
+        running_background_.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+template <template <typename> typename Queue>
+bool BasicThreadPool<Queue>::get_task_(Worker* worker, Task& task) {
+    const Priority* order = pick_order(worker ? worker->picks : 0);
+    for (int i = 0; i < NUM_PRIORITIES; ++i) {
+        if (pop_(worker, order[i], task)) {
+            if (worker) {
+                ++worker->picks;
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+// NORMAL: own deque(LIFO, cache hot) -> shared queue -> steal from others(FIFO)
+// worker is nullptr for a thread outside the pool that helps
+template <template <typename> typename Queue>
+bool BasicThreadPool<Queue>::pop_(Worker* worker, Priority priority, Task& task) {
+    bool stealing = mode_ == Mode::WORK_STEALING && priority == Priority::NORMAL;
+    if (stealing && worker) {
+        if (auto ptr = worker->deque.pop()) {
+            task = unbox(*ptr);
+            return true;
+        }
+    }
+
+    Lane& lane = lanes_[static_cast<int>(priority)];
+    bool overflow = lane.overflow_size.load(std::memory_order_acquire) > 0;
+    if (priority == Priority::BACKGROUND) {
+        if (lane.queue.empty() && !overflow) {
+            return false;
+        }
+        // reserve a slot first, released in execute_
+        if (running_background_.fetch_add(1, std::memory_order_relaxed) >= background_limit_()) {
+            running_background_.fetch_sub(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+    if (lane.queue.try_pop(task)) {
+        return true;
+    }
+    if (overflow && lane.overflow.try_pop(task)) {
+        lane.overflow_size.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+    if (priority == Priority::BACKGROUND) {
+        running_background_.fetch_sub(1, std::memory_order_relaxed);
+        return false;
+    }
+    return stealing && steal_(worker, task);
+}
+
+template <template <typename> typename Queue>
+bool BasicThreadPool<Queue>::steal_(Worker* worker, Task& task) {
+    int n = num_slots_.load(std::memory_order_acquire);
+    if (n == 0) {
+        return false;
+    }
+    // victims on our own node first, their tasks are likely in the shared cache
+    int node = worker ? worker->node.load(std::memory_order_relaxed) : -1;
+    int start = xorshift(worker ? worker->seed : helper_seed) % n;
+    for (bool local : {true, false}) {
+        for (int i = 0; i < n; ++i) {
+            Worker& victim = *workers_[(start + i) % n];
+            if (&victim == worker || (victim.node.load(std::memory_order_relaxed) == node) != local) {
+                continue;
+            }
+            if (auto ptr = victim.deque.steal()) {
+                task = unbox(*ptr);
+                if constexpr (STATS) {
+                    if (worker) {
+                        bump(worker->counters.steals);
+                    }
                 }
-                auto task = std::move(task_queue_.front());
-                task_queue_.pop();
-                lock.unlock();
-                task();
+                return true;
             }
-        });
+        }
     }
+    return false;
 }
 
-ThreadPool::~ThreadPool() {
-    stop_ = true;
-    cv_.notify_all();
-    for (auto &t : threads_) {
-        if (t.joinable()) {
-            t.join();
+template <template <typename> typename Queue>
+bool BasicThreadPool<Queue>::has_task_() {
+    for (int i = 0; i < NUM_PRIORITIES; ++i) {
+        Lane& lane = lanes_[i];
+        if (lane.queue.empty() && lane.overflow_size.load(std::memory_order_acquire) == 0) {
+            continue;
+        }
+        // a worker that finishes a background task picks the next one itself
+        if (static_cast<Priority>(i) != Priority::BACKGROUND
+            || running_background_.load(std::memory_order_relaxed) < background_limit_()) {
+            return true;
+        }
+    }
+    if (mode_ == Mode::WORK_STEALING) {
+        int n = num_slots_.load(std::memory_order_acquire);
+        for (int i = 0; i < n; ++i) {
+            if (!workers_[i]->deque.empty()) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// leave one worker for LATENCY and NORMAL tasks, unless there is only one
+template <template <typename> typename Queue>
+int BasicThreadPool<Queue>::background_limit_() const {
+    return std::max(size() - 1, 1);
+}
+
+// busy wait a bounded time for a task, true if one showed up
+// pushes skip the wake up while someone spins, so a spinner that found work passes the notification on
+template <template <typename> typename Queue>
+bool BasicThreadPool<Queue>::spin_() {
+    int64_t spin = spin_ns_.load(std::memory_order_relaxed);
+    if (spin <= 0) {
+        return false;
+    }
+    spinning_.fetch_add(1, std::memory_order_seq_cst);
+    int64_t end = now_ns() + spin;
+    bool found = false;
+    while (!stop_) {
+        for (int i = 0; i < 32; ++i) {
+            cpu_relax();
+        }
+        if (has_task_()) {
+            found = true;
+            break;
+        }
+        if (now_ns() > end) {
+            break;
+        }
+    }
+    spinning_.fetch_sub(1, std::memory_order_seq_cst);
+    if (found) {
+        notify_();
+    }
+    return found;
+}
+
+// announce as sleeper before the last check, so a concurrent push either sees us or we see its task
+// false if the worker retires
+template <template <typename> typename Queue>
+bool BasicThreadPool<Queue>::park_(Worker& worker) {
+    sleepers_.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool retire = false;
+    if (!has_task_()) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        auto woken = [this] { return stop_ || wakeups_ > 0; };
+        if constexpr (STATS) {
+            bump(worker.counters.parks);
+        }
+        if (idle_timeout_.count() == 0) {
+            cv_.wait(lock, woken);
+        } else if (!cv_.wait_for(lock, idle_timeout_, woken) && threads_.load(std::memory_order_relaxed) > min_threads_) {
+            threads_.fetch_sub(1, std::memory_order_relaxed);
+            retire = true;
+        }
+        if constexpr (STATS) {
+            if (wakeups_ > 0) {
+                bump(worker.counters.wakeups);
+            }
         }
+        if (wakeups_ > 0) {
+            --wakeups_;
+        }
+    }
+    sleepers_.fetch_sub(1, std::memory_order_seq_cst);
+
+    // a push may have counted on us as sleeper after the timeout, stay for it
+    if (retire) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (has_task_()) {
+            threads_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        retires_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return !retire;
+}
+
+template <template <typename> typename Queue>
+void BasicThreadPool<Queue>::notify_() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (spinning_.load(std::memory_order_relaxed) > 0 || sleepers_.load(std::memory_order_relaxed) == 0) {
+        return;
     }
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (wakeups_ < sleepers_.load(std::memory_order_relaxed)) {
+            ++wakeups_;
+        }
+    }
+    cv_.notify_one();
 }
 
+template <template <typename> typename Queue>
+PriorityStats BasicThreadPool<Queue>::stats(Priority priority) const {
+    int index = static_cast<int>(priority);
+    PriorityStats stats;
+    int n = num_slots_.load(std::memory_order_acquire);
+    for (int i = 0; i < n; ++i) {
+        add_priority_stats(workers_[i]->counters, index, stats);
+    }
+    std::lock_guard<std::mutex> lock(helper_mutex_);
+    add_priority_stats(*helper_counters_, index, stats);
+    return stats;
+}
+
+template <template <typename> typename Queue>
+ThreadPoolStats BasicThreadPool<Queue>::snapshot() const {
+    ThreadPoolStats stats;
+    stats.threads = size();
+    for (int i = 0; i < NUM_PRIORITIES; ++i) {
+        stats.priorities[i] = this->stats(static_cast<Priority>(i));
+        auto& lane = lanes_[i];
+        stats.queue_depth[i] = static_cast<int64_t>(lane.queue.size()) + lane.overflow_size.load(std::memory_order_relaxed);
+    }
+
+    int n = num_slots_.load(std::memory_order_acquire);
+    for (int i = 0; i < n; ++i) {
+        auto& worker = *workers_[i];
+        auto& counters = worker.counters;
+        WorkerStats& out = stats.workers.emplace_back();
+        out.index = i;
+        out.alive = !worker.retired.load(std::memory_order_relaxed);
+        for (int j = 0; j < NUM_PRIORITIES; ++j) {
+            out.executed += counters.executed[j].load(std::memory_order_relaxed);
+        }
+        out.steals = counters.steals.load(std::memory_order_relaxed);
+        out.parks = counters.parks.load(std::memory_order_relaxed);
+        out.wakeups = counters.wakeups.load(std::memory_order_relaxed);
+        out.idle_ns = counters.idle_ns.load(std::memory_order_relaxed);
+        out.deque_size = worker.deque.size();
+    }
+    stats.grows = grows_.load(std::memory_order_relaxed);
+    stats.retires = retires_.load(std::memory_order_relaxed);
+    return stats;
+}
+
+template class BasicThreadPool<SafeQueue>;
+template class BasicThreadPool<MPMCQueue>;
+
 }  // namespace wheel
@@ -0,0 +1,109 @@
+#include <wheel/timing_wheel.hpp>
+
+#include <algorithm>
+
+namespace wheel {
+
+TimingWheel::TimingWheel(std::chrono::milliseconds tick, size_t slots, Clock::time_point start)
+    : tick_(std::max(tick, std::chrono::milliseconds(1))), start_(start), slots_(slots, -1) {}
+
+void TimingWheel::reset(int id, std::chrono::milliseconds timeout, Clock::time_point now) {
+    if (id < 0) {
+        return;
+    }
+    if (static_cast<size_t>(id) >= entries_.size()) {
+        entries_.resize(std::max<size_t>(id + 1, entries_.size() * 2));
+    }
+    // round up, never fire early
+    uint64_t deadline = std::max(ticks_(now + timeout + tick_ - Clock::duration(1)), current_);
+    auto& entry = entries_[id];
+    if (entry.linked && deadline >= entry.tick) {
+        entry.deadline = deadline;  // moved when its slot comes up
+        return;
+    }
+    if (entry.linked) {
+        unlink_(id);
+    }
+    entry.deadline = deadline;
+    link_(id, deadline);
+}
+
+bool TimingWheel::remove(int id) {
+    if (!contains(id)) {
+        return false;
+    }
+    unlink_(id);
+    return true;
+}
+
+int TimingWheel::next_timeout_ms(Clock::time_point now) const {
+    if (size_ == 0) {
+        return -1;
+    }
+    auto due = start_ + tick_ * current_;
+    if (due <= now) {
+        return 0;
+    }
+    return static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(due - now).count());
+}
+
+uint64_t TimingWheel::ticks_(Clock::time_point t) const {
+    return t <= start_ ? 0 : static_cast<uint64_t>((t - start_) / tick_);
+}
+
+void TimingWheel::link_(int id, uint64_t tick) {
+    auto& entry = entries_[id];
+    int& head = slots_[tick & (slots_.size() - 1)];
+    entry.tick = tick;
+    entry.prev = -1;
+    entry.next = head;
+    entry.linked = true;
+    if (head != -1) {
+        entries_[head].prev = id;
+    }
+    head = id;
+    ++size_;
+}
+
+void TimingWheel::unlink_(int id) {
+    auto& entry = entries_[id];
+    if (entry.prev != -1) {
+        entries_[entry.prev].next = entry.next;
+    } else {
+        slots_[entry.tick & (slots_.size() - 1)] = entry.next;
+    }
+    if (entry.next != -1) {
+        entries_[entry.next].prev = entry.prev;
+    }
+    entry.linked = false;
+    --size_;
+}
+
+// every slot up to now, at most one revolution however long the wheel was not turned
+void TimingWheel::collect_(Clock::time_point now) {
+    expired_.clear();
+    uint64_t target = ticks_(now);
+    if (target < current_) {
+        return;
+    }
+    uint64_t count = std::min<uint64_t>(target - current_ + 1, slots_.size());
+    for (uint64_t i = 0; i < count && size_ > 0; ++i) {
+        int id = slots_[(current_ + i) & (slots_.size() - 1)];
+        while (id != -1) {
+            auto& entry = entries_[id];
+            int next = entry.next;
+            if (entry.tick <= target) {  // not a later round
+                unlink_(id);
+                if (entry.deadline <= target) {
+                    expired_.push_back(id);
+                } else {
+                    link_(id, entry.deadline);
+                }
+            }
+            id = next;
+        }
+    }
+    current_ = target + 1;
+}
+
+}  // namespace wheel
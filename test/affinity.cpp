@@ -0,0 +1,45 @@
+#include <wheel/affinity.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+namespace wheel {
+
+TEST(AffinityTest, ParseCpuList) {
+    ASSERT_EQ(parse_cpu_list("0-3,8,10-11"), (std::vector<int>{0, 1, 2, 3, 8, 10, 11}));
+    ASSERT_EQ(parse_cpu_list("5"), (std::vector<int>{5}));
+    ASSERT_TRUE(parse_cpu_list("").empty());
+}
+
+TEST(AffinityTest, Topology) {
+    auto& nodes = numa_nodes();
+    ASSERT_FALSE(nodes.empty());
+    int cpu = current_cpu();
+    int node = numa_node_of(cpu);
+    ASSERT_GE(node, 0);
+    ASSERT_NE(std::find(nodes[node].begin(), nodes[node].end(), cpu), nodes[node].end());
+}
+
+TEST(AffinityTest, Placement) {
+    std::vector<std::vector<int>> nodes = {{0, 1}, {2, 3}};
+    auto pinned = [&](const PlacementPolicy& policy, int workers) {
+        std::vector<int> cpus;
+        for (int i = 0; i < workers; ++i) {
+            auto worker_cpus = policy.cpus_for(i, nodes);
+            EXPECT_EQ(worker_cpus.size(), 1);
+            cpus.push_back(worker_cpus.front());
+        }
+        return cpus;
+    };
+
+    ASSERT_TRUE(PlacementPolicy{}.cpus_for(0, nodes).empty());
+    ASSERT_EQ(pinned({.placement = Placement::SPREAD}, 5), (std::vector<int>{0, 2, 1, 3, 0}));
+    ASSERT_EQ(pinned({.placement = Placement::PACK}, 4), (std::vector<int>{0, 1, 2, 3}));
+    ASSERT_EQ(pinned({.placement = Placement::PACK, .node = 1}, 4), (std::vector<int>{2, 3, 0, 1}));
+    ASSERT_EQ(pinned({.placement = Placement::SPREAD, .cpus = {1, 2, 3}}, 3), (std::vector<int>{1, 2, 3}));
+    ASSERT_EQ((PlacementPolicy{.placement = Placement::CPU_SET}.cpus_for(7, nodes)), (std::vector<int>{0, 1, 2, 3}));
+    ASSERT_EQ((PlacementPolicy{.placement = Placement::CPU_SET, .node = 1}.cpus_for(0, nodes)), (std::vector<int>{2, 3}));
+}
+
+}  // namespace wheel
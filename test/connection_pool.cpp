@@ -0,0 +1,232 @@
+#include <wheel/connection_pool.hpp>
+
+#include <gtest/gtest.h>
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace wheel {
+
+namespace {
+
+class Upstream : public UpstreamHandler {
+public:
+    bool process() override {
+        char buf[256];
+        int n;
+        while ((n = ::recv(socket_.fd(), buf, sizeof buf, 0)) > 0) {
+            received.append(buf, n);
+        }
+        return n == -1;  // 0: closed by the peer
+    }
+    void on_close() override { ++closes; }
+
+    std::string received;
+    int closes = 0;
+};
+
+// the loop of a reactor
+void run_once(Epoll& epoll, ConnectionPool& pool, int timeout_ms = 100) {
+    int n = epoll.wait(timeout_ms);
+    for (int i = 0; i < n; ++i) {
+        auto* handler = static_cast<SocketHandler*>(epoll.get_ptr(i));
+        ASSERT_TRUE(handler->upstream());
+        pool.handle(static_cast<UpstreamHandler*>(handler), epoll.get_events(i));
+    }
+    pool.expire(ConnectionPool::Clock::now());
+}
+
+// non-blocking loopback listener, the test accepts the pool's connections itself
+Socket listener(Endpoint& endpoint) {
+    Socket socket;
+    socket.init(SOCK_STREAM | SOCK_NONBLOCK);
+    socket.bind("127.0.0.1", 0);
+    socket.listen();
+    sockaddr_in addr{};
+    socklen_t len = sizeof addr;
+    getsockname(socket.fd(), reinterpret_cast<sockaddr*>(&addr), &len);
+    endpoint = {"127.0.0.1", ntohs(addr.sin_port)};
+    return socket;
+}
+
+// acquire and run the loop until done was called
+Upstream* acquire(Epoll& epoll, ConnectionPool& pool, const Endpoint& endpoint, bool& failed) {
+    Upstream* result = nullptr;
+    bool done = false;
+    pool.acquire<Upstream>(endpoint, [&](Upstream* handler) {
+        result = handler;
+        done = true;
+    });
+    for (int i = 0; i < 20 && !done; ++i) {
+        run_once(epoll, pool);
+    }
+    failed = done && !result;
+    return result;
+}
+
+}  // namespace
+
+TEST(ConnectionPoolTest, ConnectAndReuse) {
+    Epoll epoll(16);
+    ConnectionPool pool(epoll);
+    Endpoint endpoint;
+    Socket server = listener(endpoint);
+
+    bool failed;
+    Upstream* upstream = acquire(epoll, pool, endpoint, failed);
+    ASSERT_NE(upstream, nullptr);
+    ASSERT_EQ(upstream->uses(), 1);
+    auto peer = server.accept();
+    ASSERT_TRUE(peer.has_value());
+
+    // request out through the pool, response in through the loop
+    upstream->write("ping");
+    ASSERT_TRUE(pool.flush(upstream));
+    char buf[16];
+    ASSERT_EQ(::recv(peer->fd(), buf, sizeof buf, 0), 4);
+    ASSERT_EQ(peer->send("pong"), 4);
+    for (int i = 0; i < 20 && upstream->received.empty(); ++i) {
+        run_once(epoll, pool);
+    }
+    ASSERT_EQ(upstream->received, "pong");
+
+    pool.release(upstream);
+    ASSERT_EQ(pool.idle(endpoint), 1);
+    Upstream* again = nullptr;
+    pool.acquire<Upstream>(endpoint, [&](Upstream* handler) { again = handler; });  // no loop needed
+    ASSERT_EQ(again, upstream);
+    ASSERT_EQ(again->uses(), 2);
+    ASSERT_EQ(pool.size(), 1);
+
+    pool.release(again, false);
+    ASSERT_EQ(pool.size(), 0);
+    ASSERT_EQ(pool.idle(endpoint), 0);
+}
+
+TEST(ConnectionPoolTest, ConnectRefused) {
+    Epoll epoll(16);
+    ConnectionPool pool(epoll);
+    Endpoint endpoint;
+    listener(endpoint).close();
+
+    bool failed;
+    ASSERT_EQ(acquire(epoll, pool, endpoint, failed), nullptr);
+    ASSERT_TRUE(failed);
+    ASSERT_EQ(pool.size(), 0);
+}
+
+TEST(ConnectionPoolTest, Limits) {
+    Epoll epoll(16);
+    ConnectionPool pool(epoll, {.max_idle = 1, .max_connections = 1, .max_uses = 3});
+    Endpoint endpoint;
+    Socket server = listener(endpoint);
+
+    bool failed;
+    Upstream* first = acquire(epoll, pool, endpoint, failed);
+    ASSERT_NE(first, nullptr);
+    // the only connection is in use, the second acquire waits for it
+    Upstream* second = nullptr;
+    Upstream* cancelled = nullptr;
+    pool.acquire<Upstream>(endpoint, [&](Upstream* handler) { second = handler; });
+    auto ticket = pool.acquire<Upstream>(endpoint, [&](Upstream* handler) { cancelled = handler; });
+    ASSERT_TRUE(pool.cancel(ticket));
+    run_once(epoll, pool, 10);
+    ASSERT_EQ(second, nullptr);
+    ASSERT_EQ(pool.size(), 1);
+    pool.release(first);
+    ASSERT_EQ(second, first);
+    ASSERT_EQ(second->uses(), 2);
+
+    pool.release(second);
+    ASSERT_EQ(pool.idle(endpoint), 1);
+    pool.acquire<Upstream>(endpoint, [&](Upstream* handler) { second = handler; });
+    ASSERT_EQ(second->uses(), 3);
+    pool.release(second);  // max_uses
+    ASSERT_EQ(pool.size(), 0);
+    ASSERT_EQ(cancelled, nullptr);
+}
+
+TEST(ConnectionPoolTest, DeadIdleConnections) {
+    Epoll epoll(16);
+    ConnectionPool pool(epoll, {.idle_timeout = std::chrono::milliseconds(20)});
+    Endpoint endpoint;
+    Socket server = listener(endpoint);
+
+    // closed by the peer while idle, noticed by the loop
+    bool failed;
+    Upstream* upstream = acquire(epoll, pool, endpoint, failed);
+    ASSERT_NE(upstream, nullptr);
+    pool.release(upstream);
+    server.accept()->close();
+    for (int i = 0; i < 20 && pool.size() > 0; ++i) {
+        run_once(epoll, pool);
+    }
+    ASSERT_EQ(pool.size(), 0);
+
+    // closed by the peer with no loop run in between, the health check drops it and connects anew
+    upstream = acquire(epoll, pool, endpoint, failed);
+    pool.release(upstream);
+    server.accept()->close();
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    Upstream* fresh = acquire(epoll, pool, endpoint, failed);
+    ASSERT_NE(fresh, nullptr);
+    ASSERT_EQ(fresh->uses(), 1);
+    ASSERT_EQ(pool.size(), 1);
+
+    // idle too long
+    pool.release(fresh);
+    ASSERT_EQ(pool.idle(endpoint), 1);
+    ASSERT_GT(pool.next_timeout_ms(ConnectionPool::Clock::now()), 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    pool.expire(ConnectionPool::Clock::now());
+    ASSERT_EQ(pool.size(), 0);
+}
+
+// closed with zerocopy sends in flight: the buffer stays until the kernel is done with it, the peer gets it all
+TEST(ConnectionPoolTest, CloseKeepsZerocopy) {
+    Epoll epoll(16);
+    ConnectionPool pool(epoll);
+    Endpoint endpoint;
+    Socket server = listener(endpoint);
+
+    bool failed;
+    Upstream* upstream = acquire(epoll, pool, endpoint, failed);
+    ASSERT_NE(upstream, nullptr);
+    auto peer = server.accept();
+    ASSERT_TRUE(peer.has_value());
+    auto blob = std::make_shared<std::string>(1 << 20, 'z');
+    std::weak_ptr<const std::string> weak = blob;
+    upstream->write_zerocopy(std::move(blob));
+    ASSERT_TRUE(pool.flush(upstream));
+    size_t sent = (1 << 20) - upstream->pending_output();
+    ASSERT_GT(upstream->zerocopy_in_flight(), 0);  // loopback completes once the peer read it
+
+    pool.release(upstream, false);
+    pool.expire(ConnectionPool::Clock::now());  // frees the handler
+    ASSERT_FALSE(weak.expired());
+    std::string received;
+    char buf[65536];
+    int n;
+    while ((n = ::recv(peer->fd(), buf, sizeof buf, 0)) > 0) {
+        received.append(buf, n);
+    }
+    ASSERT_EQ(n, 0);
+    ASSERT_EQ(received, std::string(sent, 'z'));
+
+    // released by a later flush of any handler
+    Upstream other;
+    for (int i = 0; i < 100 && !weak.expired(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        other.flush();
+    }
+    ASSERT_TRUE(weak.expired());
+}
+
+}  // namespace wheel
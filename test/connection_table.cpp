@@ -0,0 +1,60 @@
+#include <wheel/connection_table.hpp>
+
+#include <gtest/gtest.h>
+
+namespace wheel {
+
+namespace {
+
+int alive = 0;
+
+class Handler : public SocketHandler {
+public:
+    explicit Handler(int id = 0) : id(id) { ++alive; }
+    ~Handler() { --alive; }
+
+    bool process() override { return true; }
+
+    int id;
+    char state[100];
+};
+
+}  // namespace
+
+TEST(ConnectionTableTest, EmplaceFindErase) {
+    {
+        ConnectionTable table(sizeof(Handler), alignof(Handler), 4);
+        ASSERT_EQ(table.capacity(), 4);
+        auto* a = table.emplace<Handler>(3, 1);
+        auto* b = table.emplace<Handler>(10, 2);  // past the preallocated slots
+        ASSERT_EQ(table.size(), 2);
+        ASSERT_EQ(table.find(3), a);
+        ASSERT_EQ(table.find(10), b);
+        ASSERT_EQ(table.find(4), nullptr);
+        ASSERT_EQ(table.find(-1), nullptr);
+        ASSERT_EQ(table.find(1000), nullptr);
+
+        // an erased handler's block is the next one handed out
+        ASSERT_TRUE(table.erase(3));
+        ASSERT_FALSE(table.erase(3));
+        ASSERT_EQ(alive, 1);
+        auto* c = table.emplace<Handler>(7, 3);
+        ASSERT_EQ(static_cast<void*>(c), static_cast<void*>(a));
+        ASSERT_EQ(c->id, 3);
+
+        // a reused fd replaces the old handler
+        table.emplace<Handler>(7, 4);
+        ASSERT_EQ(alive, 2);
+        ASSERT_EQ(static_cast<Handler*>(table.find(7))->id, 4);
+
+        // beyond the preallocated blocks
+        for (int fd = 20; fd < 100; ++fd) {
+            table.emplace<Handler>(fd);
+        }
+        ASSERT_EQ(table.size(), 82);
+        ASSERT_EQ(table.capacity(), 4 + 2 * ConnectionTable::CHUNK);
+    }
+    ASSERT_EQ(alive, 0);
+}
+
+}  // namespace wheel
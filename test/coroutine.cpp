@@ -0,0 +1,84 @@
+#include <wheel/coroutine.hpp>
+#include <wheel/thread_pool.hpp>
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <thread>
+
+namespace wheel {
+
+namespace {
+
+task<int> add(int a, int b) {
+    co_return a + b;
+}
+
+task<int> depth(int n) {
+    if (n == 0) {
+        co_return 0;
+    }
+    co_return 1 + co_await depth(n - 1);
+}
+
+task<std::thread::id> on_pool(ThreadPool& pool) {
+    co_await pool.schedule();
+    co_return std::this_thread::get_id();
+}
+
+task<int> delayed(ThreadPool& pool, int value, int ms) {
+    co_await pool.schedule();
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    co_return value;
+}
+
+task<void> fail() {
+    throw std::runtime_error("error");
+    co_return;
+}
+
+}  // namespace
+
+TEST(CoroutineTest, Await) {
+    ASSERT_EQ(sync_wait(add(1, 2)), 3);
+    // symmetric transfer, awaiting chains do not grow the stack
+    ASSERT_EQ(sync_wait(depth(10000)), 10000);
+    ASSERT_THROW(sync_wait(fail()), std::runtime_error);
+}
+
+TEST(CoroutineTest, Schedule) {
+    ThreadPool thread_pool(2);
+    ASSERT_NE(sync_wait(on_pool(thread_pool)), std::this_thread::get_id());
+}
+
+TEST(CoroutineTest, WhenAll) {
+    ThreadPool thread_pool(4);
+
+    std::vector<task<int>> tasks;
+    for (int i = 0; i < 100; ++i) {
+        tasks.push_back(delayed(thread_pool, i, 0));
+    }
+    auto values = sync_wait(when_all(std::move(tasks)));
+    ASSERT_EQ(values.size(), 100);
+    ASSERT_EQ(values[99], 99);
+
+    auto [a, b, c] = sync_wait(when_all(add(1, 2), delayed(thread_pool, 4, 1), depth(5)));
+    ASSERT_EQ(a + b + c, 12);
+
+    std::vector<task<void>> failing;
+    failing.push_back(fail());
+    ASSERT_THROW(sync_wait(when_all(std::move(failing))), std::runtime_error);
+}
+
+TEST(CoroutineTest, WhenAny) {
+    ThreadPool thread_pool(4);
+
+    std::vector<task<int>> tasks;
+    tasks.push_back(delayed(thread_pool, 1, 200));
+    tasks.push_back(delayed(thread_pool, 2, 0));
+    auto [index, value] = sync_wait(when_any(std::move(tasks)));
+    ASSERT_EQ(index, 1);
+    ASSERT_EQ(value, 2);
+}
+
+}  // namespace wheel
@@ -0,0 +1,128 @@
+#include <wheel/datagram_handler.hpp>
+
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+namespace wheel {
+
+namespace {
+
+class Handler : public DatagramHandler {
+public:
+    explicit Handler(DatagramOptions options = {}, bool echo = false) : DatagramHandler(options), echo(echo) {}
+
+    bool on_datagram(std::span<const char> data, const sockaddr_in& peer) override {
+        datagrams.emplace_back(data.begin(), data.end());
+        if (echo) {
+            send_to(data, peer);
+        }
+        return true;
+    }
+
+    bool echo;
+    std::vector<std::string> datagrams;
+};
+
+// udp socket on a loopback port of its own
+Socket udp_socket(sockaddr_in& addr) {
+    Socket socket;
+    socket.init(SOCK_DGRAM | SOCK_NONBLOCK);
+    socket.bind("127.0.0.1", 0);
+    socklen_t len = sizeof addr;
+    getsockname(socket.fd(), reinterpret_cast<sockaddr*>(&addr), &len);
+    return socket;
+}
+
+}  // namespace
+
+TEST(DatagramHandlerTest, BatchAndEcho) {
+    sockaddr_in server_addr{}, client_addr{};
+    Handler handler({.batch = 16}, true);
+    handler.set_socket(udp_socket(server_addr));
+    Socket client = udp_socket(client_addr);
+
+    std::vector<std::string> expected;
+    for (int i = 0; i < 100; ++i) {
+        expected.push_back(std::string(1 + i * 7, static_cast<char>('a' + i % 26)));
+        ASSERT_EQ(sendto(client.fd(), expected.back().data(), expected.back().size(), 0,
+                         reinterpret_cast<sockaddr*>(&server_addr), sizeof server_addr),
+                  static_cast<ssize_t>(expected.back().size()));
+    }
+    ASSERT_TRUE(handler.process());  // several batches, echoes flushed at the end
+    ASSERT_EQ(handler.datagrams, expected);
+    ASSERT_EQ(handler.pending_datagrams(), 0);
+
+    char buf[2048];
+    for (auto& msg : expected) {
+        sockaddr_in from{};
+        socklen_t len = sizeof from;
+        ssize_t n = recvfrom(client.fd(), buf, sizeof buf, 0, reinterpret_cast<sockaddr*>(&from), &len);
+        ASSERT_EQ(std::string(buf, n), msg);
+        ASSERT_EQ(from.sin_port, server_addr.sin_port);
+    }
+
+    // too long for the receive buffer
+    std::string big(3000, 'x');
+    sendto(client.fd(), big.data(), big.size(), 0, reinterpret_cast<sockaddr*>(&server_addr), sizeof server_addr);
+    handler.datagrams.clear();
+    ASSERT_TRUE(handler.process());
+    ASSERT_TRUE(handler.datagrams.empty());
+}
+
+TEST(DatagramHandlerTest, SegmentAndCoalesce) {
+    sockaddr_in receiver_addr{}, sender_addr{};
+    Handler receiver({.gro = true});
+    receiver.set_socket(udp_socket(receiver_addr));
+    Handler sender({.gso = true});
+    sender.set_socket(udp_socket(sender_addr));
+    int one = 1;
+    if (setsockopt(receiver.socket().fd(), SOL_UDP, UDP_GRO, &one, sizeof one) == -1) {
+        GTEST_SKIP() << "no udp gro";
+    }
+
+    // 20 full segments and a short last one in one segmented send, then a datagram of another size
+    std::vector<std::string> expected;
+    for (int i = 0; i < 20; ++i) {
+        expected.push_back(std::string(1000, static_cast<char>('a' + i)));
+    }
+    expected.push_back("tail");
+    expected.push_back(std::string(1200, 'z'));
+    for (auto& msg : expected) {
+        sender.send_to(msg, receiver_addr);
+    }
+    ASSERT_TRUE(sender.flush_datagrams());
+    ASSERT_EQ(sender.pending_datagrams(), 0);
+
+    ASSERT_TRUE(receiver.process());
+    ASSERT_EQ(receiver.datagrams, expected);
+}
+
+// what a flush left queued is sent on the writable event
+TEST(DatagramHandlerTest, WritableFlushes) {
+    sockaddr_in receiver_addr{}, sender_addr{};
+    Handler receiver;
+    receiver.set_socket(udp_socket(receiver_addr));
+    Handler sender;
+    sender.set_socket(udp_socket(sender_addr));
+
+    std::vector<std::string> expected = {"one", "two"};
+    for (auto& msg : expected) {
+        sender.send_to(msg, receiver_addr);
+    }
+    ASSERT_EQ(sender.pending_datagrams(), 2);
+    ASSERT_TRUE(sender.on_writable());
+    ASSERT_EQ(sender.pending_datagrams(), 0);
+
+    ASSERT_TRUE(receiver.process());
+    ASSERT_EQ(receiver.datagrams, expected);
+}
+
+}  // namespace wheel
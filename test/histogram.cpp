@@ -0,0 +1,43 @@
+#include <wheel/histogram.hpp>
+
+#include <gtest/gtest.h>
+
+namespace wheel {
+
+TEST(HistogramTest, Buckets) {
+    for (uint64_t value : {0ull, 1ull, 3ull, 4ull, 5ull, 7ull, 8ull, 1000ull, 123456789ull, ~0ull}) {
+        int bucket = Histogram::bucket_of(value);
+        ASSERT_LE(value, Histogram::upper_bound_of(bucket));
+        if (bucket > 0) {
+            ASSERT_GT(value, Histogram::upper_bound_of(bucket - 1));
+        }
+    }
+    ASSERT_EQ(Histogram::bucket_of(~0ull), Histogram::BUCKETS - 1 - Histogram::SUB_BUCKETS);
+}
+
+TEST(HistogramTest, Percentile) {
+    Histogram histogram;
+    for (uint64_t i = 1; i <= 1000; ++i) {
+        histogram.record(i);
+    }
+    ASSERT_EQ(histogram.count(), 1000);
+    ASSERT_DOUBLE_EQ(histogram.mean(), 500.5);
+    // buckets are at most 25% wide
+    ASSERT_GE(histogram.percentile(0.5), 500);
+    ASSERT_LE(histogram.percentile(0.5), 500 * 5 / 4);
+    ASSERT_GE(histogram.percentile(0.99), 990);
+    ASSERT_LE(histogram.percentile(1), 1023);
+
+    ConcurrentHistogram concurrent;
+    concurrent.record(10);
+    concurrent.record(1000);
+    Histogram snapshot;
+    concurrent.snapshot_into(snapshot);
+    ASSERT_EQ(snapshot.count(), 2);
+    ASSERT_EQ(snapshot.mean(), 505);  // the recorded values, not the bucket bounds
+    ASSERT_EQ(snapshot.percentile(1), Histogram::upper_bound_of(Histogram::bucket_of(1000)));
+    snapshot.merge(histogram);
+    ASSERT_EQ(snapshot.count(), 1002);
+}
+
+}  // namespace wheel
@@ -0,0 +1,117 @@
+#include <wheel/io_uring.hpp>
+
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <string>
+#include <vector>
+
+namespace wheel {
+
+TEST(IoUringTest, RecvMultishot) {
+    if (!IoUring::supported()) {
+        GTEST_SKIP() << "io_uring lacks multishot recv or provided buffers";
+    }
+    IoUring ring(8);
+    ASSERT_TRUE(ring.ok());
+    ASSERT_TRUE(ring.init_buffers(1, 4, 16));
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    ASSERT_TRUE(ring.recv_multishot(sv[0], 1, 42));
+
+    // more messages than buffers, each buffer goes back after use
+    std::string received;
+    for (int i = 0; i < 10; ++i) {
+        std::string msg = "message " + std::to_string(i);
+        ASSERT_EQ(write(sv[1], msg.data(), msg.size()), static_cast<ssize_t>(msg.size()));
+        ring.submit_and_wait(1, 1000);
+        ring.for_each_cqe([&](const io_uring_cqe& cqe) {
+            ASSERT_EQ(cqe.user_data, 42);
+            ASSERT_GT(cqe.res, 0);
+            ASSERT_TRUE(cqe.flags & IORING_CQE_F_BUFFER);
+            ASSERT_TRUE(cqe.flags & IORING_CQE_F_MORE);
+            auto id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+            auto data = ring.buffer(id, cqe.res);
+            received.append(data.data(), data.size());
+            ring.return_buffer(id);
+        });
+        ASSERT_EQ(received, msg);
+        received.clear();
+    }
+
+    // a send linked to a shutdown, the peer sees the data and then eof
+    close(sv[0]);
+    close(sv[1]);
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    ASSERT_TRUE(ring.send(sv[0], "bye", 3, 1, true));
+    ASSERT_TRUE(ring.shutdown(sv[0], SHUT_WR, 2));
+    int completed = 0;
+    while (completed < 2) {
+        ring.submit_and_wait(1, 1000);
+        ring.for_each_cqe([&](const io_uring_cqe& cqe) {
+            if (cqe.user_data == 1 || cqe.user_data == 2) {  // not the recv above ending
+                ASSERT_GE(cqe.res, 0);
+                ++completed;
+            }
+        });
+    }
+    char buf[8];
+    ASSERT_EQ(read(sv[1], buf, sizeof buf), 3);
+    ASSERT_EQ(read(sv[1], buf, sizeof buf), 0);
+    close(sv[0]);
+    close(sv[1]);
+}
+
+TEST(IoUringTest, BuffersExhausted) {
+    if (!IoUring::supported()) {
+        GTEST_SKIP() << "io_uring lacks multishot recv or provided buffers";
+    }
+    IoUring ring(8);
+    ASSERT_TRUE(ring.ok());
+    ASSERT_TRUE(ring.init_buffers(1, 2, 16));
+    ASSERT_EQ(ring.buffers_free(), 2);
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+    ASSERT_TRUE(ring.recv_multishot(sv[0], 1, 42));
+
+    // more data than both buffers hold: the recv takes them and ends with ENOBUFS
+    std::string sent(64, 'x');
+    ASSERT_EQ(write(sv[1], sent.data(), sent.size()), static_cast<ssize_t>(sent.size()));
+    std::vector<uint16_t> held;
+    bool ended = false;
+    while (!ended) {
+        ASSERT_GE(ring.submit_and_wait(1, 1000), 0);
+        ring.for_each_cqe([&](const io_uring_cqe& cqe) {
+            if (cqe.res > 0) {
+                held.push_back(static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+            } else {
+                ASSERT_EQ(cqe.res, -ENOBUFS);
+                ASSERT_FALSE(cqe.flags & IORING_CQE_F_MORE);
+                ended = true;
+            }
+        });
+    }
+    ASSERT_EQ(held.size(), 2);
+    ASSERT_EQ(ring.buffers_free(), 0);  // a new recv would fail at once
+
+    // one back, the next recv gets data again
+    ring.return_buffer(held[0]);
+    ASSERT_EQ(ring.buffers_free(), 1);
+    ASSERT_TRUE(ring.recv_multishot(sv[0], 1, 43));
+    int received = 0;
+    ASSERT_GE(ring.submit_and_wait(1, 1000), 0);
+    ring.for_each_cqe([&](const io_uring_cqe& cqe) {
+        if (cqe.res > 0) {
+            received += cqe.res;
+        }
+    });
+    ASSERT_EQ(received, 16);
+    ASSERT_EQ(ring.buffers_free(), 0);
+    close(sv[0]);
+    close(sv[1]);
+}
+
+}  // namespace wheel
@@ -0,0 +1,47 @@
+#include <wheel/job.hpp>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <memory>
+
+TEST(JobTest, InlineAndHeap) {
+    int count = 0;
+    wheel::Job small([&count] { ++count; });
+    static_assert(wheel::Job::is_inline<decltype([&count] { ++count; })>);
+    small();
+
+    std::array<int, 64> big{};
+    big[63] = 2;
+    static_assert(!wheel::Job::is_inline<decltype([&count, big] { count += big[63]; })>);
+    wheel::Job large([&count, big] { count += big[63]; });
+    large();
+    EXPECT_EQ(count, 3);
+
+    // moving keeps both kinds callable
+    wheel::Job moved_small = std::move(small);
+    wheel::Job moved_large = std::move(large);
+    EXPECT_FALSE(small);
+    EXPECT_FALSE(large);
+    moved_small();
+    moved_large();
+    EXPECT_EQ(count, 6);
+}
+
+TEST(JobTest, MoveOnly) {
+    auto ptr = std::make_unique<int>(42);
+    int result = 0;
+    wheel::Job job([ptr = std::move(ptr), &result] { result = *ptr; });
+    wheel::Job other;
+    other = std::move(job);
+    other();
+    EXPECT_EQ(result, 42);
+
+    // destroying a job destroys its captures
+    auto shared = std::make_shared<int>(0);
+    {
+        wheel::Job holder([shared] {});
+        EXPECT_EQ(shared.use_count(), 2);
+    }
+    EXPECT_EQ(shared.use_count(), 1);
+}
@@ -0,0 +1,137 @@
+#include <wheel/message_handler.hpp>
+
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+namespace wheel {
+
+namespace {
+
+class Handler : public MessageHandler {
+public:
+    explicit Handler(Framing framing) : MessageHandler(framing) {}
+
+    using MessageHandler::process;
+
+    bool process(std::string_view msg) override {
+        messages.emplace_back(msg);
+        return msg != "bye";
+    }
+
+    std::vector<std::string> messages;
+};
+
+std::string frame(Framing framing, std::string_view msg) {
+    char header[MessageHandler::MAX_HEADER];
+    size_t n = MessageHandler::encode_header(framing, msg.size(), header);
+    return std::string(header, n) + std::string(msg);
+}
+
+// takes wrapped messages as they lie in the ring
+class SpanHandler : public MessageHandler {
+public:
+    SpanHandler() : MessageHandler(Framing::U32) {}
+
+    using MessageHandler::process;
+
+    bool process(std::string_view) override { return false; }
+    bool process(std::span<const char> head, std::span<const char> tail) override {
+        wrapped += !tail.empty();
+        messages.emplace_back(head.begin(), head.end());
+        messages.back().append(tail.begin(), tail.end());
+        return true;
+    }
+
+    int wrapped = 0;
+    std::vector<std::string> messages;
+};
+
+}  // namespace
+
+TEST(MessageHandlerTest, Header) {
+    for (auto framing : {Framing::DECIMAL, Framing::U32, Framing::VARINT}) {
+        for (size_t size : {0, 1, 127, 128, 9999, 300000}) {
+            char header[MessageHandler::MAX_HEADER];
+            size_t n = MessageHandler::encode_header(framing, size, header);
+            if (framing == Framing::DECIMAL && size > 9999) {
+                ASSERT_EQ(n, 0);
+                continue;
+            }
+            size_t decoded;
+            ASSERT_EQ(MessageHandler::decode_header(framing, {header, n}, decoded), static_cast<int>(n));
+            ASSERT_EQ(decoded, size);
+            ASSERT_EQ(MessageHandler::decode_header(framing, {header, n - 1}, decoded), 0);
+        }
+    }
+    char header[MessageHandler::MAX_HEADER];
+    ASSERT_EQ(MessageHandler::encode_header(Framing::VARINT, 100, header), 1);
+    ASSERT_EQ(MessageHandler::encode_header(Framing::VARINT, 300, header), 2);
+    size_t size;
+    ASSERT_EQ(MessageHandler::decode_header(Framing::DECIMAL, "12a4", size), -1);
+    ASSERT_EQ(MessageHandler::decode_header(Framing::U32, "\xff\xff\xff\xff", size), -1);  // over MAX_MESSAGE
+}
+
+// many messages per recv, messages split over recvs, and one larger than the first buffer
+TEST(MessageHandlerTest, Drain) {
+    for (auto framing : {Framing::DECIMAL, Framing::U32, Framing::VARINT}) {
+        int sv[2];
+        ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv), 0);
+        Handler handler(framing);
+        handler.set_socket(Socket::adopt(sv[0]));
+
+        std::vector<std::string> expected;
+        std::string stream;
+        for (int i = 0; i < 200; ++i) {
+            expected.push_back("message " + std::to_string(i));
+        }
+        expected.push_back(std::string(framing == Framing::DECIMAL ? 9000 : 100000, 'x'));
+        expected.push_back("last");
+        for (auto& msg : expected) {
+            stream += frame(framing, msg);
+        }
+        for (size_t i = 0; i < stream.size(); i += 1000) {
+            size_t n = std::min<size_t>(1000, stream.size() - i);
+            ASSERT_EQ(::write(sv[1], stream.data() + i, n), static_cast<ssize_t>(n));
+            ASSERT_TRUE(handler.process());
+            ASSERT_EQ(handler.reading(), i + n < stream.size());
+        }
+        ASSERT_EQ(handler.messages, expected);
+
+        // false from process(msg), and a peer that hangs up
+        std::string bye = frame(framing, "bye");
+        ASSERT_EQ(::write(sv[1], bye.data(), bye.size()), static_cast<ssize_t>(bye.size()));
+        ASSERT_FALSE(handler.process());
+        close(sv[1]);
+        ASSERT_FALSE(handler.process());
+    }
+}
+
+TEST(MessageHandlerTest, WrappedViews) {
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv), 0);
+    SpanHandler handler;
+    handler.set_socket(Socket::adopt(sv[0]));
+
+    // the last message of every write stays partial, so the ring never empties and wraps
+    std::vector<std::string> expected;
+    std::string stream;
+    for (int i = 0; i < 1000; ++i) {
+        expected.push_back(std::string(60 + i % 7, static_cast<char>('a' + i % 26)));
+        stream += frame(Framing::U32, expected.back());
+    }
+    for (size_t i = 0; i < stream.size(); i += 1000) {
+        size_t n = std::min<size_t>(1000, stream.size() - i);
+        ASSERT_EQ(::write(sv[1], stream.data() + i, n), static_cast<ssize_t>(n));
+        ASSERT_TRUE(handler.process());
+    }
+    ASSERT_EQ(handler.messages, expected);
+    ASSERT_GT(handler.wrapped, 0);
+    close(sv[1]);
+}
+
+}  // namespace wheel
@@ -0,0 +1,86 @@
+#include <wheel/mpmc_queue.hpp>
+
+#include <gtest/gtest.h>
+
+#include <array>
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST(MPMCQueueTest, PushAndPop) {
+    wheel::MPMCQueue<int> queue(4);
+    EXPECT_EQ(queue.capacity(), 4);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(queue.try_push(i));
+    }
+    EXPECT_FALSE(queue.try_push(4));
+    EXPECT_EQ(queue.size(), 4);
+
+    int value;
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(queue.try_pop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(queue.try_pop(value));
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(MPMCQueueTest, MoveOnlyNotConsumedWhenFull) {
+    wheel::MPMCQueue<std::unique_ptr<int>> queue(2);
+    EXPECT_TRUE(queue.try_push(std::make_unique<int>(1)));
+    EXPECT_TRUE(queue.try_push(std::make_unique<int>(2)));
+    auto p = std::make_unique<int>(3);
+    EXPECT_FALSE(queue.try_push(std::move(p)));
+    ASSERT_NE(p, nullptr);
+    EXPECT_EQ(*p, 3);
+}
+
+TEST(MPMCQueueTest, Bulk) {
+    wheel::MPMCQueue<int> queue(8);
+    std::array<int, 6> in = {1, 2, 3, 4, 5, 6};
+    EXPECT_EQ(queue.push_bulk(in.begin(), in.size()), 6);
+    EXPECT_EQ(queue.push_bulk(in.begin(), in.size()), 2);  // only 2 free cells left
+
+    std::array<int, 8> out;
+    EXPECT_EQ(queue.pop_bulk(out.begin(), 5), 5);
+    EXPECT_EQ(out[4], 5);
+    EXPECT_EQ(queue.pop_bulk(out.begin(), 8), 3);
+    EXPECT_EQ(out[0], 6);
+    EXPECT_EQ(out[1], 1);
+    EXPECT_EQ(out[2], 2);
+    EXPECT_EQ(queue.pop_bulk(out.begin(), 8), 0);
+}
+
+TEST(MPMCQueueTest, MultiThread) {
+    constexpr int THREADS = 4;
+    constexpr int N = 100000;
+    wheel::MPMCQueue<int> queue(1024);
+    std::atomic<long long> sum = 0;
+    std::atomic<int> popped = 0;
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&] {
+            for (int i = 1; i <= N; ++i) {
+                while (!queue.try_push(i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+        threads.emplace_back([&] {
+            int value;
+            while (popped.load() < THREADS * N) {
+                if (queue.try_pop(value)) {
+                    sum += value;
+                    ++popped;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(sum.load(), THREADS * (1LL * N * (N + 1) / 2));
+}
@@ -0,0 +1,54 @@
+#include <wheel/mpsc_queue.hpp>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST(MPSCQueueTest, PushAndDrain) {
+    wheel::MPSCQueue<std::unique_ptr<int>> queue;
+    EXPECT_TRUE(queue.empty());
+    EXPECT_TRUE(queue.push(std::make_unique<int>(0)));  // was empty
+    for (int i = 1; i < 5; ++i) {
+        EXPECT_FALSE(queue.push(std::make_unique<int>(i)));
+    }
+
+    std::vector<int> out;
+    EXPECT_EQ(queue.drain([&](std::unique_ptr<int>& p) { out.push_back(*p); }), 5);
+    EXPECT_EQ(out, (std::vector<int>{0, 1, 2, 3, 4}));
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.drain([](std::unique_ptr<int>&) {}), 0);
+
+    queue.push(std::make_unique<int>(5));  // freed by the destructor
+}
+
+TEST(MPSCQueueTest, Producers) {
+    constexpr int PRODUCERS = 4, COUNT = 20000;
+    wheel::MPSCQueue<std::pair<int, int>> queue;
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; ++p) {
+        producers.emplace_back([&queue, p] {
+            for (int i = 0; i < COUNT; ++i) {
+                queue.push({p, i});
+            }
+        });
+    }
+
+    // every producer's items in its order, while they are still pushing
+    std::vector<int> next(PRODUCERS, 0);
+    int total = 0;
+    bool ordered = true;
+    while (total < PRODUCERS * COUNT) {
+        total += queue.drain([&](std::pair<int, int>& item) {
+            ordered = ordered && item.second == next[item.first];
+            next[item.first] = item.second + 1;
+        });
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    EXPECT_TRUE(ordered);
+    EXPECT_EQ(next, std::vector<int>(PRODUCERS, COUNT));
+    EXPECT_TRUE(queue.empty());
+}
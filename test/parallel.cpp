@@ -0,0 +1,61 @@
+#include <wheel/parallel.hpp>
+#include <wheel/thread_pool.hpp>
+
+#include <gtest/gtest.h>
+
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+namespace wheel {
+
+class ParallelTest : public ::testing::TestWithParam<Partition> {};
+
+TEST_P(ParallelTest, For) {
+    ThreadPool thread_pool(4);
+    std::vector<int> values(100000, 0);
+    parallel_for(thread_pool, 0, static_cast<int>(values.size()), [&](int i) { values[i] += i; }, GetParam());
+    for (int i = 0; i < static_cast<int>(values.size()); ++i) {
+        ASSERT_EQ(values[i], i);
+    }
+
+    parallel_for(thread_pool, values.begin(), values.end(), [](int& value) { value = 1; }, GetParam(), 64);
+    ASSERT_EQ(std::accumulate(values.begin(), values.end(), 0), 100000);
+}
+
+TEST_P(ParallelTest, TransformAndReduce) {
+    ThreadPool thread_pool(4);
+    std::vector<int> in(100000);
+    std::iota(in.begin(), in.end(), 0);
+    std::vector<long long> out(in.size());
+    parallel_transform(thread_pool, in.begin(), in.end(), out.begin(), [](int x) { return 2LL * x; }, GetParam());
+    ASSERT_EQ(out[99999], 199998);
+
+    auto sum = parallel_reduce(thread_pool, out.begin(), out.end(), 0LL, GetParam());
+    ASSERT_EQ(sum, 99999LL * 100000);
+
+    auto max = parallel_reduce(thread_pool, 0, 100000, -1,
+                               [](int a, int b) { return std::max(a, b); }, [](int i) { return i % 1000; }, GetParam());
+    ASSERT_EQ(max, 999);
+}
+
+TEST_P(ParallelTest, NestedAndException) {
+    // workers run inner loops and help while waiting, nothing blocks
+    ThreadPool thread_pool(2, ThreadPool::Mode::WORK_STEALING);
+    std::atomic<int> count = 0;
+    parallel_for(thread_pool, 0, 16, [&](int) {
+        parallel_for(thread_pool, 0, 100, [&](int) { ++count; }, GetParam());
+    }, GetParam());
+    ASSERT_EQ(count.load(), 1600);
+
+    ASSERT_THROW(parallel_for(thread_pool, 0, 1000, [](int i) {
+        if (i == 500) {
+            throw std::runtime_error("error");
+        }
+    }, GetParam()), std::runtime_error);
+}
+
+INSTANTIATE_TEST_SUITE_P(Partition, ParallelTest,
+                         ::testing::Values(Partition::STATIC, Partition::GUIDED, Partition::ADAPTIVE));
+
+}  // namespace wheel
@@ -43,3 +43,26 @@ TEST_F(RingBufferTest, WrapAroundPutAndGet) {
     EXPECT_EQ(out_data[2], 2);
     EXPECT_EQ(out_data[3], 3);
 }
+
+TEST_F(RingBufferTest, Spans) {
+    std::array<int, 3> data = {1, 2, 3};
+    buffer.put(data, data.size());
+    buffer.pop(2);
+    auto free = buffer.write_spans();  // wraps: index 3, then 0 and 1
+    ASSERT_EQ(free[0].size(), 1);
+    ASSERT_EQ(free[1].size(), 2);
+    free[0][0] = 4;
+    free[1][0] = 5;
+    buffer.commit(2);
+    EXPECT_EQ(buffer.size(), 3);
+
+    auto used = buffer.read_spans(3);
+    ASSERT_EQ(used[0].size(), 2);
+    ASSERT_EQ(used[1].size(), 1);
+    EXPECT_EQ(used[0][0], 3);
+    EXPECT_EQ(used[0][1], 4);
+    EXPECT_EQ(used[1][0], 5);
+
+    buffer.pop(3);  // empty starts over at the front
+    EXPECT_EQ(buffer.write_spans()[0].size(), 4);
+}
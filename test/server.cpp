@@ -0,0 +1,219 @@
+#include <wheel/server.hpp>
+#include <wheel/stream_handler.hpp>
+
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace wheel {
+
+namespace {
+
+constexpr ServerMode MODES[] = {ServerMode::THREAD_POOL, ServerMode::MULTI_REACTOR, ServerMode::IO_URING};
+
+class Echo : public StreamHandler {
+public:
+    bool on_recv(std::span<const char> data, std::string& reply) override {
+        reply.append(data.data(), data.size());
+        return true;
+    }
+};
+
+// every request answered with 4 MiB, more than a socket takes at once
+class Large : public StreamHandler {
+public:
+    static constexpr size_t SIZE = 4 << 20;
+
+    bool on_recv(std::span<const char>, std::string& reply) override {
+        reply.append(SIZE, 'x');
+        return true;
+    }
+};
+
+// the server on its own thread, stopped at the end of the scope
+template <typename Handler = Echo>
+class ServerThread {
+public:
+    ServerThread(ServerOptions options, int threads = 1)
+        : server_(std::move(options)), thread_([this, threads] { server_.start(0, threads); }) {}
+    ~ServerThread() { stop(); }
+
+    void stop() {
+        if (thread_.joinable()) {
+            server_.stop();
+            thread_.join();
+        }
+    }
+
+private:
+    Server<Handler> server_;
+    std::thread thread_;
+};
+
+// abstract unix names, no port to collide with
+std::string path_of(const char* test, ServerMode mode) {
+    return std::string("@wheel-test-") + test + "-" + std::to_string(static_cast<int>(mode));
+}
+
+// retried until the server listens, recv gives up after a second
+Socket connect_client(const std::string& path) {
+    Socket socket;
+    for (int i = 0; i < 100; ++i) {
+        socket.init(SOCK_STREAM, AF_UNIX);
+        if (socket.connect_unix(path)) {
+            timeval timeout{.tv_sec = 1, .tv_usec = 0};
+            setsockopt(socket.fd(), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+            return socket;
+        }
+        socket.close();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ADD_FAILURE() << "no server on " << path;
+    return socket;
+}
+
+// with SO_RCVTIMEO the kernel doesn't restart a recv, io_uring task work of an earlier ring interrupts it
+int recv_retry(Socket& socket, void* buf, size_t len, int flags = 0) {
+    int n;
+    while ((n = ::recv(socket.fd(), buf, len, flags)) == -1 && errno == EINTR) {
+    }
+    return n;
+}
+
+bool echo(Socket& socket, std::string_view message) {
+    if (socket.send(message) != static_cast<int>(message.size())) {
+        return false;
+    }
+    std::string received(message.size(), '\0');
+    size_t got = 0;
+    int n;
+    while (got < received.size() && (n = recv_retry(socket, received.data() + got, received.size() - got)) > 0) {
+        got += n;
+    }
+    return received == message;
+}
+
+bool closed_by_server(Socket& socket) {
+    char c;
+    int n = recv_retry(socket, &c, 1);
+    return n == 0 || (n == -1 && errno == ECONNRESET);
+}
+
+}  // namespace
+
+TEST(ServerTest, Echo) {
+    for (auto mode : MODES) {
+        SCOPED_TRACE(static_cast<int>(mode));
+        std::string path = path_of("echo", mode);
+        // more connections at once than an accept batch takes
+        ServerThread<> server({.mode = mode, .accept_batch = 2, .unix_path = path}, 2);
+        std::vector<Socket> clients;
+        for (int i = 0; i < 10; ++i) {
+            clients.push_back(connect_client(path));
+        }
+        for (int round = 0; round < 3; ++round) {
+            for (size_t i = 0; i < clients.size(); ++i) {
+                EXPECT_TRUE(echo(clients[i], "message " + std::to_string(i)));
+            }
+        }
+    }
+}
+
+TEST(ServerTest, IdleTimeout) {
+    for (auto mode : MODES) {
+        SCOPED_TRACE(static_cast<int>(mode));
+        std::string path = path_of("idle", mode);
+        ServerThread<> server({.mode = mode, .read_timeout = std::chrono::milliseconds(100), .unix_path = path});
+        Socket active = connect_client(path);
+        Socket idle = connect_client(path);
+        ASSERT_TRUE(echo(active, "a"));  // no keepalive_timeout: kept once the request is answered
+
+        auto start = std::chrono::steady_clock::now();
+        EXPECT_TRUE(closed_by_server(idle));
+        EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(900));
+        EXPECT_TRUE(echo(active, "b"));
+    }
+}
+
+// no timeouts, the reactors sleep in epoll_wait / io_uring_enter without a deadline
+TEST(ServerTest, StopWakesReactors) {
+    for (auto mode : MODES) {
+        SCOPED_TRACE(static_cast<int>(mode));
+        std::string path = path_of("stop", mode);
+        ServerThread<> server({.mode = mode, .unix_path = path}, 2);
+        Socket client = connect_client(path);
+        ASSERT_TRUE(echo(client, "a"));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+        auto start = std::chrono::steady_clock::now();
+        server.stop();
+        EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(50));
+    }
+}
+
+// the peer half-closes right after its request, the reply still arrives in full before the close
+TEST(ServerTest, ReplyAfterHalfClose) {
+    for (auto mode : MODES) {
+        SCOPED_TRACE(static_cast<int>(mode));
+        std::string path = path_of("half", mode);
+        ServerThread<Large> server({.mode = mode, .unix_path = path});
+        Socket client = connect_client(path);
+        ASSERT_EQ(client.send("get"), 3);
+        ASSERT_EQ(::shutdown(client.fd(), SHUT_WR), 0);
+
+        std::string received;
+        char buf[65536];
+        int n;
+        while ((n = recv_retry(client, buf, sizeof buf)) > 0) {
+            received.append(buf, n);
+        }
+        EXPECT_EQ(n, 0);
+        EXPECT_EQ(received.size(), Large::SIZE);
+        EXPECT_EQ(received.find_first_not_of('x'), std::string::npos);
+    }
+}
+
+// the epoll modes, a multishot io_uring accept keeps the fd limit of when it was armed
+TEST(ServerTest, AcceptOutOfFds) {
+    for (auto mode : {ServerMode::THREAD_POOL, ServerMode::MULTI_REACTOR}) {
+        SCOPED_TRACE(static_cast<int>(mode));
+        std::string path = path_of("fds", mode);
+        ServerThread<> server({.mode = mode, .unix_path = path});
+        Socket first = connect_client(path);
+        ASSERT_TRUE(echo(first, "a"));
+
+        // no fd left for the server's accept: the connection is dropped instead of spinning on the listener
+        Socket dropped;
+        dropped.init(SOCK_STREAM, AF_UNIX);
+        timeval timeout{.tv_sec = 1, .tv_usec = 0};
+        setsockopt(dropped.fd(), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+        rlimit old;
+        getrlimit(RLIMIT_NOFILE, &old);
+        int lowest = ::open("/dev/null", O_RDONLY);
+        ::close(lowest);
+        rlimit limit = old;
+        limit.rlim_cur = lowest;
+        ASSERT_EQ(setrlimit(RLIMIT_NOFILE, &limit), 0);
+        bool connected = dropped.connect_unix(path);
+        bool closed = closed_by_server(dropped);
+        setrlimit(RLIMIT_NOFILE, &old);
+        ASSERT_TRUE(connected);
+        EXPECT_TRUE(closed);
+
+        // and serves again once fds are back
+        Socket second = connect_client(path);
+        EXPECT_TRUE(echo(second, "b"));
+        EXPECT_TRUE(echo(first, "c"));
+    }
+}
+
+}  // namespace wheel
@@ -0,0 +1,143 @@
+#include <wheel/socket.hpp>
+
+#include <gtest/gtest.h>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <string>
+#include <vector>
+
+namespace wheel {
+
+namespace {
+
+int get_option(const Socket& socket, int level, int name) {
+    int value = -1;
+    socklen_t len = sizeof value;
+    getsockopt(socket.fd(), level, name, &value, &len);
+    return value;
+}
+
+// {client, accepted} through a blocking unix listener bound to path
+std::pair<Socket, Socket> unix_connect(std::string_view path, int type, Socket& listener) {
+    listener.init(type, AF_UNIX);
+    EXPECT_TRUE(listener.bind_unix(path));
+    EXPECT_TRUE(listener.listen());
+    Socket client;
+    client.init(type, AF_UNIX);
+    EXPECT_TRUE(client.connect_unix(path));
+    auto server = listener.accept();
+    EXPECT_TRUE(server.has_value());
+    return {std::move(client), std::move(*server)};
+}
+
+}  // namespace
+
+TEST(SocketTest, UnixAbstract) {
+    std::string path = "@wheel-test-" + std::to_string(getpid());
+    Socket listener;
+    auto [client, server] = unix_connect(path, SOCK_STREAM, listener);
+    ASSERT_EQ(client.send("ping"), 4);
+    char buf[16];
+    ASSERT_EQ(server.recv(buf), 4);
+    ASSERT_EQ(std::string(buf, 4), "ping");
+    ASSERT_EQ(server.get_peer_ip(), "");  // the client is not bound
+    ASSERT_EQ(server.get_peer_port(), 0);
+
+    // taken while the listener lives
+    Socket other;
+    other.init(SOCK_STREAM, AF_UNIX);
+    ASSERT_FALSE(other.bind_unix(path));
+    ASSERT_EQ(errno, EADDRINUSE);
+    ASSERT_FALSE(other.bind_unix(std::string(108, 'x')));  // longer than sun_path
+}
+
+TEST(SocketTest, UnixPathSeqpacket) {
+    std::string path = "/tmp/wheel-test-" + std::to_string(getpid()) + ".sock";
+    {
+        Socket listener;
+        auto [client, server] = unix_connect(path, SOCK_SEQPACKET, listener);
+        struct stat st;
+        ASSERT_EQ(stat(path.c_str(), &st), 0);
+        ASSERT_TRUE(S_ISSOCK(st.st_mode));
+
+        // message boundaries are kept
+        ASSERT_EQ(client.send("first"), 5);
+        ASSERT_EQ(client.send("second"), 6);
+        char buf[16];
+        ASSERT_EQ(server.recv(buf), 5);
+        ASSERT_EQ(server.recv(buf), 6);
+        ASSERT_EQ(std::string(buf, 6), "second");
+    }
+    unlink(path.c_str());
+}
+
+TEST(SocketTest, PassFds) {
+    auto sockets = Socket::pair(SOCK_STREAM);
+    ASSERT_TRUE(sockets.has_value());
+    auto& [a, b] = *sockets;
+    int pipe_fds[2];
+    ASSERT_EQ(pipe(pipe_fds), 0);
+
+    // both ends of the pipe, then plain data
+    ASSERT_EQ(a.send_fds("fds", std::vector<int>{pipe_fds[0], pipe_fds[1]}), 3);
+    ASSERT_EQ(a.send("data"), 4);
+    close(pipe_fds[0]);
+    close(pipe_fds[1]);
+
+    std::vector<int> fds;
+    char buf[16];
+    ASSERT_EQ(b.recv_fds({buf, 3}, fds), 3);
+    ASSERT_EQ(fds.size(), 2);
+    ASSERT_EQ(b.recv_fds(buf, fds), 4);
+    ASSERT_EQ(fds.size(), 2);
+
+    // the duplicates are the same pipe
+    ASSERT_EQ(write(fds[1], "x", 1), 1);
+    ASSERT_EQ(read(fds[0], buf, 1), 1);
+    ASSERT_EQ(buf[0], 'x');
+    close(fds[0]);
+    close(fds[1]);
+
+    ASSERT_EQ(a.send_fds("", std::vector<int>{0}), -1);  // fds need a byte to travel with
+}
+
+TEST(SocketTest, Options) {
+    Socket listener;
+    listener.init(SOCK_STREAM);
+    ASSERT_TRUE(listener.apply({.nodelay = true, .recv_buffer = 1 << 20, .defer_accept = 1, .fastopen = 16}));
+    ASSERT_TRUE(listener.bind("127.0.0.1", 0));
+    ASSERT_TRUE(listener.listen());
+    sockaddr_in addr{};
+    socklen_t len = sizeof addr;
+    getsockname(listener.fd(), reinterpret_cast<sockaddr*>(&addr), &len);
+
+    Socket client;
+    client.init(SOCK_STREAM);
+    ASSERT_TRUE(client.connect("127.0.0.1", ntohs(addr.sin_port)));
+    ASSERT_EQ(client.send("x"), 1);  // defer_accept: accepted once data arrived
+    auto accepted = listener.accept();
+    ASSERT_TRUE(accepted.has_value());
+
+    // inherited from the listener
+    ASSERT_EQ(get_option(*accepted, IPPROTO_TCP, TCP_NODELAY), 1);
+    ASSERT_EQ(get_option(*accepted, SOL_SOCKET, SO_RCVBUF), 2 << 20);  // doubled by the kernel
+    ASSERT_EQ(get_option(client, IPPROTO_TCP, TCP_NODELAY), 0);
+
+    ASSERT_TRUE(accepted->apply({.nodelay = false, .cork = true, .send_buffer = 1 << 16}));
+    ASSERT_EQ(get_option(*accepted, IPPROTO_TCP, TCP_NODELAY), 0);
+    ASSERT_EQ(get_option(*accepted, IPPROTO_TCP, TCP_CORK), 1);
+    ASSERT_EQ(get_option(*accepted, SOL_SOCKET, SO_SNDBUF), 2 << 16);
+
+    // tcp options on a unix socket are refused, the others still set
+    auto sockets = Socket::pair();
+    ASSERT_FALSE(sockets->first.apply({.nodelay = true, .send_buffer = 1 << 16}));
+    ASSERT_EQ(get_option(sockets->first, SOL_SOCKET, SO_SNDBUF), 2 << 16);
+}
+
+}  // namespace wheel
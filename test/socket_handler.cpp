@@ -0,0 +1,221 @@
+#include <wheel/socket_handler.hpp>
+
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <memory>
+#include <string>
+
+namespace wheel {
+
+namespace {
+
+class Handler : public SocketHandler {
+public:
+    bool process() override { return true; }
+};
+
+// connected tcp sockets on loopback, {sender, receiver}
+std::pair<int, int> tcp_pair() {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof addr;
+    bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof addr);
+    listen(listener, 1);
+    getsockname(listener, reinterpret_cast<sockaddr*>(&addr), &len);
+    int sender = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    connect(sender, reinterpret_cast<sockaddr*>(&addr), sizeof addr);
+    int receiver = accept(listener, nullptr, nullptr);
+    close(listener);
+    return {sender, receiver};
+}
+
+}  // namespace
+
+TEST(SocketHandlerTest, WriteAndFlush) {
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv), 0);
+    Handler handler;
+    handler.set_socket(Socket::adopt(sv[0]));
+
+    // many small writes, one flush
+    std::string expected;
+    for (int i = 0; i < 100; ++i) {
+        std::string msg = "response " + std::to_string(i) + "\n";
+        handler.write(msg);
+        expected += msg;
+    }
+    ASSERT_EQ(handler.pending_output(), expected.size());
+    ASSERT_TRUE(handler.flush());
+    ASSERT_EQ(handler.pending_output(), 0);
+    std::string received(expected.size(), 0);
+    ASSERT_EQ(read(sv[1], received.data(), received.size()), static_cast<ssize_t>(expected.size()));
+    ASSERT_EQ(received, expected);
+
+    // more than the socket buffer takes, the rest stays queued until the peer reads
+    expected.clear();
+    for (int i = 0; i < 4096; ++i) {
+        std::string msg(1000, static_cast<char>('a' + i % 26));
+        handler.write(msg);
+        expected += msg;
+    }
+    ASSERT_TRUE(handler.flush());
+    ASSERT_GT(handler.pending_output(), 0);
+    received.clear();
+    char buf[65536];
+    while (received.size() < expected.size()) {
+        int n = read(sv[1], buf, sizeof buf);
+        if (n > 0) {
+            received.append(buf, n);
+        }
+        ASSERT_TRUE(handler.flush());
+    }
+    ASSERT_EQ(handler.pending_output(), 0);
+    ASSERT_EQ(received, expected);
+    close(sv[1]);
+}
+
+TEST(SocketHandlerTest, ZerocopyAndFile) {
+    auto [sender, receiver] = tcp_pair();
+    ASSERT_GE(receiver, 0);
+    Handler handler;
+    handler.set_socket(Socket::adopt(sender));
+
+    std::string file_data(300000, 0);
+    for (size_t i = 0; i < file_data.size(); ++i) {
+        file_data[i] = static_cast<char>('A' + i % 26);
+    }
+    FILE* file = std::tmpfile();
+    ASSERT_EQ(std::fwrite(file_data.data(), 1, file_data.size(), file), file_data.size());
+    std::fflush(file);
+
+    auto blob = std::make_shared<std::string>(1 << 20, 'z');
+    handler.write("header");
+    handler.write_zerocopy(blob);
+    ASSERT_TRUE(handler.write_file(fileno(file), 1000, 200000));
+    std::fclose(file);  // the handler keeps its own fd
+    handler.write("trailer");
+    std::string expected = "header" + *blob + file_data.substr(1000, 200000) + "trailer";
+    ASSERT_EQ(handler.pending_output(), expected.size());
+    blob.reset();  // the handler keeps the buffer alive
+
+    std::string received;
+    char buf[65536];
+    while (received.size() < expected.size()) {
+        ASSERT_TRUE(handler.flush());
+        pollfd pfd{.fd = receiver, .events = POLLIN, .revents = 0};
+        if (poll(&pfd, 1, 100) == 1) {
+            int n = read(receiver, buf, sizeof buf);
+            ASSERT_GT(n, 0);
+            received.append(buf, n);
+        }
+    }
+    ASSERT_EQ(handler.pending_output(), 0);
+    ASSERT_EQ(received, expected);
+
+    // completions come through the error queue once the data was acked
+    for (int i = 0; i < 100 && handler.zerocopy_in_flight() > 0; ++i) {
+        pollfd pfd{.fd = sender, .events = 0, .revents = 0};
+        poll(&pfd, 1, 10);
+        ASSERT_TRUE(handler.on_error());
+    }
+    ASSERT_EQ(handler.zerocopy_in_flight(), 0);
+    close(receiver);
+}
+
+TEST(SocketHandlerTest, ZerocopyOutlivesHandler) {
+    auto [sender, receiver] = tcp_pair();
+    ASSERT_GE(receiver, 0);
+    auto handler = std::make_unique<Handler>();
+    handler->set_socket(Socket::adopt(sender));
+    auto blob = std::make_shared<std::string>(1 << 20, 'z');
+    std::weak_ptr<const std::string> weak = blob;
+    handler->write_zerocopy(std::move(blob));
+    ASSERT_TRUE(handler->flush());
+    size_t sent = (1 << 20) - handler->pending_output();
+    ASSERT_GT(sent, 0);
+    ASSERT_GT(handler->zerocopy_in_flight(), 0);  // loopback completes once the receiver read it
+
+    // closed with the data still queued in the kernel, the buffer stays
+    handler.reset();
+    ASSERT_FALSE(weak.expired());
+    std::string received;
+    char buf[65536];
+    int n;
+    while ((n = read(receiver, buf, sizeof buf)) > 0) {
+        received.append(buf, n);
+    }
+    ASSERT_EQ(n, 0);  // the FIN after the data
+    ASSERT_EQ(received, std::string(sent, 'z'));
+
+    // released by a later flush of any handler
+    Handler other;
+    for (int i = 0; i < 100 && !weak.expired(); ++i) {
+        usleep(10000);
+        other.flush();
+    }
+    ASSERT_TRUE(weak.expired());
+    close(receiver);
+}
+
+namespace {
+
+// queues requests for later, like a pipelining protocol
+class QueueHandler : public SocketHandler {
+public:
+    bool process() override { return true; }
+    size_t pending_input() const override { return queued; }
+    void on_throttle() override { ++throttles; }
+    void on_unthrottle() override { ++unthrottles; }
+
+    size_t queued = 0;
+    int throttles = 0;
+    int unthrottles = 0;
+};
+
+}  // namespace
+
+TEST(SocketHandlerTest, Watermarks) {
+    int sv[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv), 0);
+    QueueHandler handler;
+    handler.set_socket(Socket::adopt(sv[0]));
+    handler.write(std::string(5000, 'x'));
+    ASSERT_FALSE(handler.update_throttle());  // no limits by default
+
+    handler.set_watermarks({.high = 100, .low = 10}, {.high = 4096, .low = 1024});
+    ASSERT_TRUE(handler.update_throttle());
+    ASSERT_TRUE(handler.throttled());
+    ASSERT_EQ(handler.throttles, 1);
+
+    // input above high keeps it throttled once the output is gone
+    handler.queued = 200;
+    ASSERT_TRUE(handler.flush());
+    ASSERT_EQ(handler.pending_output(), 0);
+    ASSERT_FALSE(handler.update_throttle());
+    ASSERT_TRUE(handler.throttled());
+    handler.queued = 50;  // between the marks
+    ASSERT_FALSE(handler.update_throttle());
+    handler.queued = 10;
+    ASSERT_TRUE(handler.update_throttle());
+    ASSERT_FALSE(handler.throttled());
+    ASSERT_EQ(handler.unthrottles, 1);
+
+    // output the caller still holds counts too
+    ASSERT_TRUE(handler.update_throttle(4096));
+    ASSERT_FALSE(handler.update_throttle(2000));
+    ASSERT_TRUE(handler.update_throttle(1024));
+    ASSERT_EQ(handler.throttles, 2);
+    close(sv[1]);
+}
+
+}  // namespace wheel
@@ -0,0 +1,97 @@
+#include <wheel/task_graph.hpp>
+#include <wheel/thread_pool.hpp>
+
+#include <gtest/gtest.h>
+
+namespace wheel {
+
+TEST(TaskGraphTest, Diamond) {
+    ThreadPool pool(4);
+
+    // a -> b, c -> d
+    std::atomic<int> order = 0;
+    int a = -1, b = -1, c = -1, d = -1;
+    TaskGraph graph;
+    auto na = graph.emplace("a", [&] { a = order++; });
+    auto nb = graph.emplace("b", [&] { b = order++; });
+    auto nc = graph.emplace("c", [&] { c = order++; });
+    auto nd = graph.emplace("d", [&] { d = order++; });
+    graph.precede(na, nb);
+    graph.precede(na, nc);
+    graph.precede(nb, nd);
+    graph.precede(nc, nd);
+
+    // instantiated once, run many times
+    for (int i = 0; i < 100; ++i) {
+        order = 0;
+        graph.run(pool).get();
+        ASSERT_EQ(a, 0);
+        ASSERT_LT(a, b);
+        ASSERT_LT(a, c);
+        ASSERT_EQ(d, 3);
+    }
+    graph.run_and_wait(pool);
+    ASSERT_EQ(order.load(), 8);
+}
+
+TEST(TaskGraphTest, WideAndDeep) {
+    ThreadPool pool(4, ThreadPool::Mode::WORK_STEALING);
+
+    std::atomic<int> count = 0;
+    TaskGraph graph;
+    auto source = graph.emplace("source", [] {});
+    auto sink = graph.emplace("sink", [] {});
+    for (int i = 0; i < 100; ++i) {
+        auto previous = source;
+        for (int j = 0; j < 10; ++j) {
+            auto node = graph.emplace("node", [&count] { ++count; });
+            graph.precede(previous, node);
+            previous = node;
+        }
+        graph.precede(previous, sink);
+    }
+    for (int i = 0; i < 10; ++i) {
+        graph.run(pool).get();
+    }
+    ASSERT_EQ(count.load(), 10000);
+}
+
+TEST(TaskGraphTest, ExceptionAndCycle) {
+    ThreadPool pool(2);
+
+    bool after_ran = false;
+    TaskGraph graph;
+    auto fail = graph.emplace("fail", [] { throw std::runtime_error("error"); });
+    auto after = graph.emplace("after", [&] { after_ran = true; });
+    graph.precede(fail, after);
+    ASSERT_THROW(graph.run(pool).get(), std::runtime_error);
+    ASSERT_FALSE(after_ran);
+
+    graph.precede(after, fail);
+    ASSERT_THROW(graph.run(pool), std::logic_error);
+
+    TaskGraph empty;
+    empty.run(pool).get();
+}
+
+TEST(TaskGraphTest, CriticalPath) {
+    ThreadPool pool(4);
+
+    auto sleep = [](int ms) { return [ms] { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }; };
+    TaskGraph graph;
+    auto start = graph.emplace("start", sleep(1));
+    auto fast = graph.emplace("fast", sleep(1));
+    auto slow = graph.emplace("slow", sleep(20));
+    auto end = graph.emplace("end", sleep(1));
+    graph.precede(start, fast);
+    graph.precede(start, slow);
+    graph.precede(fast, end);
+    graph.precede(slow, end);
+    graph.run(pool).get();
+
+    ASSERT_EQ(graph.critical_path(), (std::vector<TaskGraph::Node>{start, slow, end}));
+    ASSERT_GE(graph.makespan(), 22'000'000);
+    ASSERT_NE(graph.report().find("slow"), std::string::npos);
+}
+
+}  // namespace wheel
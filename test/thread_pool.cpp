@@ -25,4 +25,246 @@ TEST(ThreadPoolTest, Basic) {
     ASSERT_EQ(res, 50005000);
 }
 
+TEST(ThreadPoolTest, WorkStealing) {
+    wheel::ThreadPool thread_pool(4, ThreadPool::Mode::WORK_STEALING);
+
+    // every task spawns its children from a worker, so they go to the local deques
+    std::atomic<int> count = 0;
+    std::function<void(int)> spawn = [&](int depth) {
+        count.fetch_add(1, std::memory_order_relaxed);
+        if (depth > 0) {
+            thread_pool.submit(spawn, depth - 1);
+            thread_pool.submit(spawn, depth - 1);
+        }
+    };
+    thread_pool.submit(spawn, 13).get();
+    while (count.load() != (1 << 14) - 1) {
+        std::this_thread::yield();
+    }
+    ASSERT_EQ(count.load(), (1 << 14) - 1);
+
+    auto future = thread_pool.submit([&thread_pool] {
+        return thread_pool.submit([](int a, int b) { return a * b; }, 6, 7);
+    });
+    ASSERT_EQ(future.get().get(), 42);
+}
+
+TEST(ThreadPoolTest, LockFreeQueue) {
+    // workers submit more tasks than the bounded queue holds, and help when it is full
+    wheel::LockFreeThreadPool thread_pool(4);
+
+    std::atomic<int> count = 0;
+    std::vector<std::future<void>> futures;
+    for (int i = 0; i < 100; ++i) {
+        futures.push_back(thread_pool.submit([&] {
+            for (int j = 0; j < 200; ++j) {
+                thread_pool.submit([&] { ++count; });
+            }
+        }));
+    }
+    for (auto& future : futures) {
+        future.get();
+    }
+    while (count.load() != 20000) {
+        std::this_thread::yield();
+    }
+    ASSERT_EQ(count.load(), 20000);
+}
+
+TEST(ThreadPoolTest, AsyncAndPost) {
+    wheel::ThreadPool thread_pool(4);
+
+    std::vector<wheel::Future<int>> futures;
+    for (int i = 0; i < 10000; ++i) {
+        futures.push_back(thread_pool.async([](int a, int b) { return a + b; }, i, 1));
+    }
+    int res = 0;
+    for (auto& future : futures) {
+        res += future.get();
+    }
+    ASSERT_EQ(res, 50005000);
+
+    auto error = thread_pool.async([] { throw std::runtime_error("error"); });
+    ASSERT_THROW(error.get(), std::runtime_error);
+
+    std::atomic<int> count = 0;
+    for (int i = 0; i < 10000; ++i) {
+        thread_pool.post([&count](int n) { count += n; }, 1);
+    }
+    thread_pool.async([] {}).get();
+    while (count.load() != 10000) {
+        std::this_thread::yield();
+    }
+    ASSERT_EQ(count.load(), 10000);
+}
+
+TEST(ThreadPoolTest, Priority) {
+    wheel::ThreadPool thread_pool(1);
+    thread_pool.set_stats_sample_period(1);
+
+    // hold the only worker until everything is queued
+    std::atomic<bool> gate = false;
+    thread_pool.post([&gate] { gate.wait(false); });
+
+    std::vector<char> order;
+    thread_pool.post({.priority = Priority::BACKGROUND}, [&order] { order.push_back('b'); });
+    thread_pool.post({.priority = Priority::NORMAL}, [&order] { order.push_back('n'); });
+    thread_pool.post({.priority = Priority::LATENCY}, [&order] { order.push_back('l'); });
+    gate = true;
+    gate.notify_one();
+    thread_pool.async({.priority = Priority::BACKGROUND}, [] {}).get();
+    ASSERT_EQ(order, (std::vector<char>{'l', 'n', 'b'}));
+
+    // a background task is not starved by a stream of latency tasks
+    gate = false;
+    thread_pool.post([&gate] { gate.wait(false); });
+    std::atomic<int> done = 0;
+    int background_position = -1;
+    thread_pool.post({.priority = Priority::BACKGROUND}, [&] { background_position = done; });
+    for (int i = 0; i < 200; ++i) {
+        thread_pool.post({.priority = Priority::LATENCY}, [&done] { ++done; });
+    }
+    gate = true;
+    gate.notify_one();
+    while (done.load() != 200 || background_position < 0) {
+        std::this_thread::yield();
+    }
+    ASSERT_LT(background_position, 100);
+
+#if WHEEL_THREAD_POOL_STATS
+    auto stats = thread_pool.stats(Priority::LATENCY);
+    ASSERT_EQ(stats.executed, 201);
+    ASSERT_EQ(stats.queue_wait.count(), 201);
+    ASSERT_GT(stats.queue_wait.percentile(0.99), 0);
+#endif
+}
+
+TEST(ThreadPoolTest, Deadline) {
+    wheel::ThreadPool thread_pool(1);
+
+    std::atomic<bool> gate = false;
+    thread_pool.post([&gate] { gate.wait(false); });
+
+    auto past = std::chrono::steady_clock::now();
+    auto dropped = thread_pool.async({.deadline = past}, [] { return 1; });
+    std::atomic<bool> demoted_ran = false;
+    thread_pool.post({.deadline = past, .on_deadline = DeadlinePolicy::DEMOTE}, [&demoted_ran] { demoted_ran = true; });
+    auto in_time = thread_pool.async({.deadline = past + std::chrono::hours(1)}, [] { return 2; });
+    gate = true;
+    gate.notify_one();
+
+    ASSERT_THROW(dropped.get(), std::future_error);
+    ASSERT_EQ(in_time.get(), 2);
+    while (!demoted_ran) {
+        std::this_thread::yield();
+    }
+
+#if WHEEL_THREAD_POOL_STATS
+    auto normal = thread_pool.stats(Priority::NORMAL);
+    ASSERT_EQ(normal.dropped, 1);
+    ASSERT_EQ(normal.demoted, 1);
+    ASSERT_EQ(normal.executed, 2);  // the gate and in_time
+    ASSERT_EQ(thread_pool.stats(Priority::BACKGROUND).executed, 1);
+#endif
+}
+
+TEST(ThreadPoolTest, Placement) {
+    std::vector<int> cpus;
+    for (auto& node : numa_nodes()) {
+        cpus.insert(cpus.end(), node.begin(), node.end());
+    }
+    wheel::ThreadPool thread_pool(2, ThreadPool::Mode::WORK_STEALING, {.placement = Placement::PACK, .name = "pool"});
+
+    for (int i = 0; i < 10; ++i) {
+        auto [name, cpu] = thread_pool.async([] {
+            char name[16] = {};
+            pthread_getname_np(pthread_self(), name, sizeof name);
+            return std::pair<std::string, int>(name, current_cpu());
+        }).get();
+        ASSERT_TRUE(name == "pool/0" || name == "pool/1");
+        ASSERT_NE(std::find(cpus.begin(), cpus.end(), cpu), cpus.end());
+    }
+}
+
+TEST(ThreadPoolTest, Elastic) {
+    wheel::ThreadPool thread_pool(1);
+    thread_pool.set_elastic({
+        .min_threads = 1,
+        .max_threads = 4,
+        .grow_queue_depth = 2,
+        .idle_timeout = std::chrono::milliseconds(20),
+        .spin = std::chrono::microseconds(50),
+    });
+
+    for (int round = 0; round < 2; ++round) {
+        // blocked tasks pile up, the pool grows to max_threads
+        std::atomic<bool> gate = false;
+        std::atomic<int> count = 0;
+        for (int i = 0; i < 16; ++i) {
+            thread_pool.post([&] {
+                gate.wait(false);
+                ++count;
+            });
+        }
+        int grown = thread_pool.size();
+        gate = true;
+        gate.notify_all();
+        while (count.load() != 16) {
+            std::this_thread::yield();
+        }
+        ASSERT_EQ(grown, 4);
+
+        // idle workers retire down to min_threads, their slots are reused in the next round
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (thread_pool.size() > 1 && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        ASSERT_EQ(thread_pool.size(), 1);
+    }
+    ASSERT_EQ(thread_pool.async([] { return 42; }).get(), 42);
+}
+
+#if WHEEL_THREAD_POOL_STATS
+TEST(ThreadPoolTest, Snapshot) {
+    wheel::ThreadPool thread_pool(2, ThreadPool::Mode::WORK_STEALING);
+    thread_pool.set_stats_sample_period(1);
+
+    std::atomic<int> count = 0;
+    thread_pool.async([&] {
+        for (int i = 0; i < 1000; ++i) {
+            thread_pool.post([&count] { ++count; });
+        }
+    }).get();
+    while (count.load() != 1000) {
+        std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));  // let the workers park
+
+    auto stats = thread_pool.snapshot();
+    ASSERT_EQ(stats.threads, 2);
+    ASSERT_EQ(stats.workers.size(), 2);
+    auto& normal = stats.priorities[static_cast<int>(Priority::NORMAL)];
+    ASSERT_EQ(normal.executed, 1001);
+    ASSERT_EQ(normal.queue_wait.count(), 1001);
+    ASSERT_EQ(normal.run_time.count(), 1001);
+    uint64_t executed = 0, parks = 0;
+    for (auto& worker : stats.workers) {
+        ASSERT_TRUE(worker.alive);
+        ASSERT_EQ(worker.deque_size, 0);
+        executed += worker.executed;
+        parks += worker.parks;
+    }
+    ASSERT_EQ(executed, 1001);
+    ASSERT_GT(parks, 0);
+    ASSERT_EQ(stats.queue_depth[static_cast<int>(Priority::NORMAL)], 0);
+
+    // no timing, counters only
+    thread_pool.set_stats_sample_period(0);
+    thread_pool.async([] {}).get();
+    normal = thread_pool.stats(Priority::NORMAL);
+    ASSERT_EQ(normal.executed, 1002);
+    ASSERT_EQ(normal.queue_wait.count(), 1001);
+}
+#endif
+
 }  // namespace wheel
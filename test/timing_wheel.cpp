@@ -0,0 +1,75 @@
+#include <wheel/timing_wheel.hpp>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+namespace wheel {
+
+using std::chrono::milliseconds;
+
+namespace {
+
+std::vector<int> expire(TimingWheel& wheel, TimingWheel::Clock::time_point now) {
+    std::vector<int> ids;
+    wheel.expire(now, [&](int id) { ids.push_back(id); });
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+}  // namespace
+
+TEST(TimingWheelTest, ResetExpire) {
+    auto t0 = TimingWheel::Clock::now();
+    TimingWheel wheel(milliseconds(10), 8, t0);
+    ASSERT_EQ(wheel.next_timeout_ms(t0), -1);
+
+    wheel.reset(3, milliseconds(25), t0);
+    wheel.reset(5, milliseconds(50), t0);
+    wheel.reset(7, milliseconds(50), t0);
+    ASSERT_EQ(wheel.size(), 3);
+    ASSERT_EQ(wheel.next_timeout_ms(t0), 0);
+
+    ASSERT_TRUE(expire(wheel, t0 + milliseconds(20)).empty());  // never early
+    ASSERT_EQ(expire(wheel, t0 + milliseconds(30)), std::vector<int>{3});
+    ASSERT_FALSE(wheel.contains(3));
+
+    // a later deadline stays in its slot until the slot comes up
+    wheel.reset(5, milliseconds(50), t0 + milliseconds(30));
+    ASSERT_TRUE(wheel.remove(7));
+    ASSERT_FALSE(wheel.remove(7));
+    ASSERT_TRUE(expire(wheel, t0 + milliseconds(60)).empty());
+    ASSERT_EQ(expire(wheel, t0 + milliseconds(80)), std::vector<int>{5});
+    ASSERT_EQ(wheel.size(), 0);
+}
+
+TEST(TimingWheelTest, EarlierDeadline) {
+    auto t0 = TimingWheel::Clock::now();
+    TimingWheel wheel(milliseconds(10), 8, t0);
+    wheel.reset(1, milliseconds(60), t0);
+    wheel.reset(1, milliseconds(10), t0);
+    ASSERT_EQ(wheel.size(), 1);
+    ASSERT_EQ(expire(wheel, t0 + milliseconds(10)), std::vector<int>{1});
+}
+
+TEST(TimingWheelTest, Rounds) {
+    auto t0 = TimingWheel::Clock::now();
+    TimingWheel wheel(milliseconds(10), 8, t0);  // 80 ms per revolution
+    wheel.reset(1, milliseconds(30), t0);
+    wheel.reset(2, milliseconds(110), t0);  // same slot, next round
+    wheel.reset(3, milliseconds(1000), t0);
+    ASSERT_EQ(expire(wheel, t0 + milliseconds(30)), std::vector<int>{1});
+    ASSERT_TRUE(expire(wheel, t0 + milliseconds(100)).empty());
+    ASSERT_EQ(expire(wheel, t0 + milliseconds(110)), std::vector<int>{2});
+    // not turned for many revolutions
+    ASSERT_EQ(expire(wheel, t0 + milliseconds(5000)), std::vector<int>{3});
+
+    // expire may re-arm what it expires
+    wheel.reset(4, milliseconds(10), t0 + milliseconds(5000));
+    size_t n = wheel.expire(t0 + milliseconds(5010), [&](int id) { wheel.reset(id, milliseconds(10), t0 + milliseconds(5010)); });
+    ASSERT_EQ(n, 1);
+    ASSERT_TRUE(wheel.contains(4));
+}
+
+}  // namespace wheel